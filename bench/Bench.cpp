@@ -0,0 +1,670 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Chip8.h"
+#include "Fusion.h"
+#include "Harness.h"
+#include "Interpreter.h"
+#include "MemoryScanner.h"
+#include "Opcode.h"
+#include "Quirks.h"
+#include "RomCatalog.h"
+#include "Sha1.h"
+#include "Upscaler.h"
+
+// Micro and macro benchmarks for the emulator core. Results are written as JSON in the same
+// shape Google Benchmark uses, so the usual comparison scripts work on two runs.
+//
+//   chip8_bench [--filter text] [--min-time seconds] [--cycles n] [--roms dir] [--out file]
+
+#ifndef CHIP8_ROM_DIR
+#define CHIP8_ROM_DIR "roms"
+#endif
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult
+{
+	std::string Name;
+	int64_t Iterations;
+	double NanosPerIteration;
+	double ItemsPerSecond;
+};
+
+static std::vector<BenchResult> results;
+static std::string filter;
+static double minTime = 0.2;
+
+// Stops the optimiser from throwing away work whose result is never looked at
+static volatile uint64_t sink;
+
+static bool Selected(const std::string& name)
+{
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+static void Report(const std::string& name, int64_t iterations, double seconds, int64_t items)
+{
+	BenchResult result{name, iterations, seconds * 1e9 / iterations, items / seconds};
+	results.push_back(result);
+
+	std::cerr << name << ": " << result.NanosPerIteration << " ns/op, " << iterations << " iterations\n";
+}
+
+// Runs body(batch) with growing batches until one takes at least minTime
+static void Run(const std::string& name, const std::function<void(int64_t)>& body, int64_t itemsPerIteration = 1)
+{
+	if (!Selected(name))
+		return;
+
+	body(1);
+
+	int64_t batch = 1;
+	while (true)
+	{
+		auto start = Clock::now();
+		body(batch);
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (seconds >= minTime || batch >= (int64_t(1) << 40))
+		{
+			Report(name, batch, seconds, batch * itemsPerIteration);
+			return;
+		}
+
+		double scale = seconds > 0 ? minTime * 1.4 / seconds : 100;
+		batch = std::max(batch * 2, (int64_t)(batch * std::min(scale, 100.0)));
+	}
+}
+
+static std::unique_ptr<Chip8> MakeCpu(Profile profile)
+{
+	auto cpu = std::make_unique<Chip8>();
+	cpu->SetProfile(profile);
+
+	for (int i = 0; i < 16; i++)
+		cpu->Registers[i] = (byte)(i * 37 + 11);
+
+	cpu->IndexRegister = 0x300;
+	for (int i = 0; i < 0x100; i++)
+		cpu->Memory[0x300 + i] = (byte)(i * 73 + 5);
+
+	return cpu;
+}
+
+static void BenchDecode()
+{
+	// A spread of real instructions, every one of them should find its table entry
+	static const word codes[] =
+	{
+		0x00E0, 0x00EE, 0x1234, 0x2345, 0x3A12, 0x4B34, 0x5120, 0x6A55, 0x7B01, 0x8120,
+		0x8121, 0x8122, 0x8123, 0x8124, 0x8125, 0x8126, 0x8127, 0x812E, 0x9120, 0xA300,
+		0xB400, 0xC0FF, 0xD125, 0xE19E, 0xE1A1, 0xF107, 0xF10A, 0xF115, 0xF118, 0xF11E,
+		0xF129, 0xF133, 0xF155, 0xF165, 0x0000, 0xFFFF
+	};
+	const int count = ARRAYLEN(codes);
+
+	const std::pair<const char*, Variant> variants[] =
+	{
+		{"Chip8", Variant::Chip8}, {"SuperChip", Variant::SuperChip}, {"XoChip", Variant::XoChip}
+	};
+
+	for (const auto& variant : variants)
+	{
+		Run(std::string("decode/Match/") + variant.first, [&](int64_t batch)
+			{
+				uintptr_t total = 0;
+				for (int64_t i = 0; i < batch; i++)
+					for (int c = 0; c < count; c++)
+						total += (uintptr_t)&Opcodes::Match(codes[c], variant.second);
+				sink = total;
+			}, count);
+	}
+
+	Run("decode/Match/all_words", [&](int64_t batch)
+		{
+			uintptr_t total = 0;
+			for (int64_t i = 0; i < batch; i++)
+				for (int code = 0; code < 0x10000; code++)
+					total += (uintptr_t)&Opcodes::Match((word)code, Variant::XoChip);
+			sink = total;
+		}, 0x10000);
+}
+
+template <typename Quirks>
+static void BenchHandler(const char* name, void (*handler)(word, Chip8&), word code)
+{
+	std::string fullName = std::string("handler/") + Quirks::Name + "/" + name;
+	if (!Selected(fullName))
+		return;
+
+	Profile profile = Quirks::Target == Variant::SuperChip ? Profile::SuperChip
+		: Quirks::Target == Variant::XoChip ? Profile::XoChip : Profile::Modern;
+	auto cpu = MakeCpu(profile);
+
+	// The program counter and stack are put back every time so calls, returns and jumps can
+	// be measured in isolation, which costs the same small amount for every handler
+	Run(fullName, [&](int64_t batch)
+		{
+			for (int64_t i = 0; i < batch; i++)
+			{
+				cpu->ProgramCounter = PROGRAM_START;
+				cpu->StackPointer = 1;
+				handler(code, *cpu);
+			}
+			sink = cpu->Registers[0xF] + cpu->ProgramCounter;
+		});
+}
+
+static void BenchHandlers()
+{
+	using Base = Interpreter<Quirks::Modern>;
+	using Super = Interpreter<Quirks::SuperChip>;
+	using Xo = Interpreter<Quirks::XoChip>;
+
+	BenchHandler<Quirks::Modern>("00E0", Base::Op00E0, 0x00E0);
+	BenchHandler<Quirks::Modern>("00EE", Base::Op00EE, 0x00EE);
+	BenchHandler<Quirks::Modern>("1nnn", Base::Op1nnn, 0x1234);
+	BenchHandler<Quirks::Modern>("2nnn", Base::Op2nnn, 0x2345);
+	BenchHandler<Quirks::Modern>("3xkk", Base::Op3xkk, 0x3A12);
+	BenchHandler<Quirks::Modern>("4xkk", Base::Op4xkk, 0x4B34);
+	BenchHandler<Quirks::Modern>("5xy0", Base::Op5xy0, 0x5120);
+	BenchHandler<Quirks::Modern>("6xkk", Base::Op6xkk, 0x6A55);
+	BenchHandler<Quirks::Modern>("7xkk", Base::Op7xkk, 0x7B01);
+	BenchHandler<Quirks::Modern>("8xy0", Base::Op8xy0, 0x8120);
+	BenchHandler<Quirks::Modern>("8xy1", Base::Op8xy1, 0x8121);
+	BenchHandler<Quirks::Modern>("8xy2", Base::Op8xy2, 0x8122);
+	BenchHandler<Quirks::Modern>("8xy3", Base::Op8xy3, 0x8123);
+	BenchHandler<Quirks::Modern>("8xy4", Base::Op8xy4, 0x8124);
+	BenchHandler<Quirks::Modern>("8xy5", Base::Op8xy5, 0x8125);
+	BenchHandler<Quirks::Modern>("8xy6", Base::Op8xy6, 0x8126);
+	BenchHandler<Quirks::Modern>("8xy7", Base::Op8xy7, 0x8127);
+	BenchHandler<Quirks::Modern>("8xyE", Base::Op8xyE, 0x812E);
+	BenchHandler<Quirks::Modern>("9xy0", Base::Op9xy0, 0x9120);
+	BenchHandler<Quirks::Modern>("Annn", Base::OpAnnn, 0xA300);
+	BenchHandler<Quirks::Modern>("Bnnn", Base::OpBnnn, 0xB400);
+	BenchHandler<Quirks::Modern>("Cxkk", Base::OpCxkk, 0xC0FF);
+	BenchHandler<Quirks::Modern>("Dxyn", Base::OpDxyn, 0xD125);
+	BenchHandler<Quirks::Modern>("Ex9E", Base::OpEx9E, 0xE19E);
+	BenchHandler<Quirks::Modern>("ExA1", Base::OpExA1, 0xE1A1);
+	BenchHandler<Quirks::Modern>("Fx07", Base::OpFx07, 0xF107);
+	BenchHandler<Quirks::Modern>("Fx0A", Base::OpFx0A, 0xF10A);
+	BenchHandler<Quirks::Modern>("Fx15", Base::OpFx15, 0xF115);
+	BenchHandler<Quirks::Modern>("Fx18", Base::OpFx18, 0xF118);
+	BenchHandler<Quirks::Modern>("Fx1E", Base::OpFx1E, 0xF11E);
+	BenchHandler<Quirks::Modern>("Fx29", Base::OpFx29, 0xF129);
+	BenchHandler<Quirks::Modern>("Fx33", Base::OpFx33, 0xF133);
+	BenchHandler<Quirks::Modern>("Fx55", Base::OpFx55, 0xFF55);
+	BenchHandler<Quirks::Modern>("Fx65", Base::OpFx65, 0xFF65);
+
+	BenchHandler<Quirks::SuperChip>("00Cn", Super::Op00Cn, 0x00C4);
+	BenchHandler<Quirks::SuperChip>("00FB", Super::Op00FB, 0x00FB);
+	BenchHandler<Quirks::SuperChip>("00FC", Super::Op00FC, 0x00FC);
+	BenchHandler<Quirks::SuperChip>("00FE", Super::Op00FE, 0x00FE);
+	BenchHandler<Quirks::SuperChip>("00FF", Super::Op00FF, 0x00FF);
+	BenchHandler<Quirks::SuperChip>("Dxy0", Super::OpDxy0, 0xD120);
+	BenchHandler<Quirks::SuperChip>("Fx30", Super::OpFx30, 0xF130);
+	BenchHandler<Quirks::SuperChip>("Fx75", Super::OpFx75, 0xF775);
+	BenchHandler<Quirks::SuperChip>("Fx85", Super::OpFx85, 0xF785);
+
+	BenchHandler<Quirks::XoChip>("00Dn", Xo::Op00Dn, 0x00D4);
+	BenchHandler<Quirks::XoChip>("5xy2", Xo::Op5xy2, 0x5182);
+	BenchHandler<Quirks::XoChip>("5xy3", Xo::Op5xy3, 0x5183);
+	BenchHandler<Quirks::XoChip>("F000", Xo::OpF000, 0xF000);
+	BenchHandler<Quirks::XoChip>("Fn01", Xo::OpFn01, 0xF301);
+	BenchHandler<Quirks::XoChip>("F002", Xo::OpF002, 0xF002);
+	BenchHandler<Quirks::XoChip>("Fx3A", Xo::OpFx3A, 0xF13A);
+}
+
+static void BenchDraw()
+{
+	struct DrawCase
+	{
+		const char* Name;
+		Profile QuirkProfile;
+		bool HighResolution;
+		int X, Y, Height;
+	};
+
+	// Aligned and unaligned columns, the clipped edges and the 16x16 SUPER-CHIP sprite
+	static const DrawCase cases[] =
+	{
+		{"lores/h1/aligned", Profile::Modern, false, 0, 0, 1},
+		{"lores/h5/aligned", Profile::Modern, false, 8, 4, 5},
+		{"lores/h5/unaligned", Profile::Modern, false, 13, 4, 5},
+		{"lores/h15/unaligned", Profile::Modern, false, 29, 9, 15},
+		{"lores/h15/clip_right", Profile::Modern, false, 60, 9, 15},
+		{"lores/h15/clip_bottom", Profile::Modern, false, 20, 28, 15},
+		{"lores/h15/wrap_corner", Profile::XoChip, false, 60, 28, 15},
+		{"hires/h15/unaligned", Profile::SuperChip, true, 61, 20, 15},
+		{"hires/h15/clip_right", Profile::SuperChip, true, 124, 20, 15},
+		{"hires/h16/big", Profile::SuperChip, true, 57, 20, 0},
+		{"hires/h16/big_xo_2planes", Profile::XoChip, true, 57, 20, 0}
+	};
+
+	for (const DrawCase& draw : cases)
+	{
+		auto cpu = MakeCpu(draw.QuirkProfile);
+		cpu->SetResolution(draw.HighResolution);
+		cpu->Registers[1] = draw.X;
+		cpu->Registers[2] = draw.Y;
+		if (draw.QuirkProfile == Profile::XoChip && strstr(draw.Name, "2planes"))
+			cpu->PlaneMask = 3;
+
+		word code = 0xD120 | draw.Height;
+
+		Run(std::string("draw/Dxyn/") + draw.Name, [&](int64_t batch)
+			{
+				VisitProfile(cpu->QuirkProfile, [&](auto quirks)
+					{
+						for (int64_t i = 0; i < batch; i++)
+							Interpreter<decltype(quirks)>::Execute(code, *cpu);
+					});
+				sink = cpu->Registers[0xF];
+			});
+	}
+}
+
+// The display path: framebuffer to a 640x320 RGBA image through every filter. The
+// framebuffer changes each iteration, otherwise the upscaler would skip the work.
+static void BenchRender()
+{
+	const uint32_t palette[4] =
+	{
+		Upscaler::PackColor(0, 0, 0), Upscaler::PackColor(255, 255, 255),
+		Upscaler::PackColor(170, 170, 170), Upscaler::PackColor(85, 85, 85)
+	};
+
+	for (int highResolution = 0; highResolution < 2; highResolution++)
+	{
+		auto cpu = MakeCpu(Profile::XoChip);
+		cpu->SetResolution(highResolution);
+		for (int y = 0; y < DISPLAY_HEIGHT; y++)
+		{
+			for (int half = 0; half < DISPLAY_ROW_WORDS; half++)
+			{
+				cpu->Graphics[0][y][half] = 0x0F0F00FF3C3C0000ull >> (y % 8);
+				cpu->Graphics[1][y][half] = 0x00FF0F0F00003C3Cull << (y % 5);
+			}
+		}
+
+		for (int filter = 0; filter < (int)ScaleFilter::Count; filter++)
+		{
+			for (int scanlines = 0; scanlines < 2; scanlines++)
+			{
+				Upscaler upscaler;
+				upscaler.Filter = (ScaleFilter)filter;
+				upscaler.ScanlineStrength = scanlines ? 128 : 0;
+
+				std::string name = std::string("render/") + ScaleFilterName(upscaler.Filter) + (highResolution ? "/hires" : "/lores") + (scanlines ? "/scanlines" : "");
+				Run(name, [&](int64_t batch)
+					{
+						for (int64_t i = 0; i < batch; i++)
+						{
+							cpu->Graphics[0][0][0] ^= 1;
+							upscaler.Render(*cpu, palette, 640, 320);
+						}
+						sink = upscaler.Pixels()[0];
+					});
+			}
+		}
+
+		// Persistence with one row changing a frame, and with every row fading at once
+		for (int everyRow = 0; everyRow < 2; everyRow++)
+		{
+			Upscaler upscaler;
+			upscaler.PersistenceDecay = 192;
+
+			std::string name = std::string("render/persistence") + (highResolution ? "/hires" : "/lores") + (everyRow ? "/all" : "");
+			Run(name, [&](int64_t batch)
+				{
+					for (int64_t i = 0; i < batch; i++)
+					{
+						if (everyRow)
+						{
+							for (int y = 0; y < DISPLAY_HEIGHT; y++)
+								cpu->Graphics[0][y][0] ^= ~0ull;
+						}
+						else
+							cpu->Graphics[0][0][0] ^= 1;
+
+						upscaler.Render(*cpu, palette, 640, 320);
+					}
+					sink = upscaler.Pixels()[0];
+				});
+		}
+	}
+}
+
+static void BenchState(const std::string& romDir)
+{
+	std::vector<byte> rom = ReadFile(fs::path(romDir) / "BRIX");
+	if (rom.empty())
+		rom.assign(64, 0x12);
+
+	auto cpu = std::make_unique<Chip8>();
+	auto copy = std::make_unique<Chip8>();
+
+	Run("state/LoadRom", [&](int64_t batch)
+		{
+			for (int64_t i = 0; i < batch; i++)
+				cpu->LoadRom(rom.data(), (int)rom.size());
+			sink = cpu->Memory[PROGRAM_START];
+		});
+
+	Run("state/UnloadRom", [&](int64_t batch)
+		{
+			for (int64_t i = 0; i < batch; i++)
+				cpu->UnloadRom();
+			sink = cpu->Memory[PROGRAM_START];
+		});
+
+	// Save states are the raw object, so a round trip is a copy out and a copy back in
+	cpu->LoadRom(rom.data(), (int)rom.size());
+	cpu->RunFrame(1000);
+
+	Run("state/Snapshot", [&](int64_t batch)
+		{
+			for (int64_t i = 0; i < batch; i++)
+			{
+				*copy = *cpu;
+				cpu->Registers[0] ^= (byte)i;
+			}
+			sink = copy->Registers[0];
+		}, sizeof(Chip8));
+
+	Run("state/SaveLoadRoundTrip", [&](int64_t batch)
+		{
+			for (int64_t i = 0; i < batch; i++)
+			{
+				memcpy((void*)copy.get(), (void*)cpu.get(), sizeof(Chip8));
+				copy->Registers[0] ^= (byte)i;
+				memcpy((void*)cpu.get(), (void*)copy.get(), sizeof(Chip8));
+			}
+			sink = cpu->Registers[0];
+		}, sizeof(Chip8));
+}
+
+// A host frame with run-ahead: the real frame, a snapshot into a spare instance and n frames
+// ahead on it, so the difference between two n is the price of one extra frame
+static void BenchRunAhead(const std::string& romDir)
+{
+	for (const char* romName : {"BRIX", "INVADERS"})
+	{
+		std::vector<byte> rom = ReadFile(fs::path(romDir) / romName);
+		if (rom.empty())
+			continue;
+
+		const KnownRom* known = RomCatalog::Identify(Sha1(rom.data(), rom.size()));
+		int cycles = known ? known->Settings.CyclesPerFrame : RomCatalog::DefaultSettings.CyclesPerFrame;
+
+		for (int frames = 0; frames <= 4; frames++)
+		{
+			auto cpu = std::make_unique<Chip8>();
+			auto ahead = std::make_unique<Chip8>();
+			cpu->LoadRom(rom.data(), (int)rom.size());
+
+			Run(std::string("runahead/") + romName + "/" + std::to_string(frames), [&](int64_t batch)
+				{
+					for (int64_t i = 0; i < batch; i++)
+					{
+						cpu->RunFrame(cycles);
+						if (frames == 0)
+							continue;
+
+						*ahead = *cpu;
+						for (int frame = 0; frame < frames; frame++)
+							ahead->RunFrame(cycles);
+					}
+					sink = ahead->ProgramCounter;
+				});
+		}
+	}
+}
+
+// One narrowing pass of the cheat search, over all of XO-CHIP memory while every address is still
+// a candidate and again once most of them have dropped out
+static void BenchScan()
+{
+	auto cpu = std::make_unique<Chip8>();
+	auto scanner = std::make_unique<MemoryScanner>();
+	cpu->SetProfile(Profile::XoChip);
+
+	srand(1);
+	for (int i = 0; i < MEMORY_SIZE; i++)
+		cpu->Memory[i] = (byte)rand();
+
+	Run("scan/narrow/full", [&](int64_t batch)
+		{
+			for (int64_t i = 0; i < batch; i++)
+			{
+				scanner->Start(*cpu);
+				sink = (byte)scanner->Narrow(*cpu, ScanPredicate::Unchanged);
+			}
+		}, MemoryScanner::SCAN_SIZE);
+
+	scanner->Start(*cpu);
+	for (int i = 0; i < MEMORY_SIZE; i += 4096)
+		cpu->Memory[i] ^= 1;
+	scanner->Narrow(*cpu, ScanPredicate::Changed);
+
+	Run("scan/narrow/sparse", [&](int64_t batch)
+		{
+			for (int64_t i = 0; i < batch; i++)
+				sink = (byte)scanner->Narrow(*cpu, ScanPredicate::Unchanged);
+		});
+}
+
+// Observers for the hook cost, each counts into a static the way a single threaded tool would
+struct FetchCounter : NullObserver
+{
+	static inline uint64_t Fetches = 0;
+	static void OnFetch(const Chip8& cpu, word address, word code) { Fetches++; }
+};
+
+struct MemoryCounter : NullObserver
+{
+	static inline uint64_t Bytes = 0;
+	static void OnRead(const Chip8& cpu, word address, int length) { Bytes += length; }
+	static void OnWrite(const Chip8& cpu, word address, int length) { Bytes += length; }
+};
+
+// The same frames through the interpreter with no observer, one hook and every hook, the first
+// should match unfused/ exactly since NullObserver compiles away
+static void BenchObservers(const std::string& romDir)
+{
+	std::vector<byte> rom = ReadFile(fs::path(romDir) / "INVADERS");
+	if (rom.empty())
+		return;
+
+	auto run = [&](const std::string& name, auto interpreter)
+	{
+		using Observed = decltype(interpreter);
+
+		auto cpu = std::make_unique<Chip8>();
+		cpu->SetProfile(Profile::Modern);
+		cpu->LoadRom(rom.data(), (int)rom.size());
+
+		Run(name, [&](int64_t batch)
+			{
+				for (int64_t i = 0; i < batch; i++)
+					Observed::RunFrame(*cpu, 200);
+				sink = cpu->ProgramCounter;
+			}, 200);
+	};
+
+	run("observer/INVADERS/none", Interpreter<Quirks::Modern>());
+	run("observer/INVADERS/fetch", Interpreter<Quirks::Modern, FetchCounter>());
+	run("observer/INVADERS/all", Interpreter<Quirks::Modern, Observers<FetchCounter, MemoryCounter>>());
+	sink = FetchCounter::Fetches + MemoryCounter::Bytes;
+}
+
+static std::vector<fs::path> ListRoms(const std::string& romDir)
+{
+	std::vector<fs::path> roms;
+	std::error_code error;
+	for (const auto& entry : fs::directory_iterator(romDir, error))
+	{
+		std::error_code entryError;
+		if (entry.is_regular_file(entryError) && entry.path().filename() != RomCatalog::IndexName)
+			roms.push_back(entry.path());
+	}
+	std::sort(roms.begin(), roms.end());
+
+	return roms;
+}
+
+// Each ROM runs through Chip8::RunFrame, which fuses, and again as unfused/ through the plain
+// interpreter for comparison. The share of instructions each kind of superinstruction covered
+// goes to stderr.
+static void BenchRoms(const std::string& romDir, int64_t cycles)
+{
+	FusionCache& cache = FusionCache::Local();
+	bool header = false;
+
+	for (const fs::path& path : ListRoms(romDir))
+	{
+		std::string name = path.filename().u8string();
+		bool fused = Selected("rom/" + name);
+		bool unfused = Selected("unfused/" + name);
+		if (!fused && !unfused)
+			continue;
+
+		std::vector<byte> rom = ReadFile(path);
+		if (rom.empty() || rom.size() > (size_t)(MEMORY_SIZE - PROGRAM_START))
+			continue;
+
+		const KnownRom* known = RomCatalog::Identify(Sha1(rom.data(), rom.size()));
+		const RomSettings& settings = known ? known->Settings : RomCatalog::DefaultSettings;
+
+		// Emulated frames are run back to back without waiting for vblank, so this is raw throughput
+		auto run = [&](const std::string& label, auto runFrame)
+		{
+			auto cpu = std::make_unique<Chip8>();
+			cpu->SetProfile(settings.QuirkProfile);
+			cpu->LoadRom(rom.data(), (int)rom.size());
+
+			int64_t executed = 0;
+			int frame = 0;
+			auto start = Clock::now();
+			while (executed < cycles)
+			{
+				ScriptInput(*cpu, frame++);
+				executed += runFrame(*cpu);
+			}
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			Report(label, frame, seconds, executed);
+		};
+
+		if (unfused)
+			run("unfused/" + name, [&](Chip8& cpu) { return VisitProfile(cpu.QuirkProfile, [&](auto quirks) { return Interpreter<decltype(quirks)>::RunFrame(cpu, settings.CyclesPerFrame); }); });
+
+		if (!fused)
+			continue;
+
+		cache.Clear();
+		cache.ResetCounts();
+		run("rom/" + name, [&](Chip8& cpu) { return cpu.RunFrame(settings.CyclesPerFrame); });
+
+		if (!header)
+		{
+			std::cerr << "  rom           hit   ";
+			for (int kind = 1; kind < (int)Fusion::Count; kind++)
+				fprintf(stderr, "%-16s", FusionName((Fusion)kind));
+			std::cerr << "per dispatch  rewrites\n";
+			header = true;
+		}
+
+		fprintf(stderr, "  %-12s %5.1f%% ", name.c_str(), cache.HitRate() * 100);
+		for (int kind = 1; kind < (int)Fusion::Count; kind++)
+			fprintf(stderr, "%5.1f%%          ", 100.0 * cache.FusedInstructions[kind] / std::max<uint64_t>(cache.Instructions, 1));
+		fprintf(stderr, "%.3f         %llu\n", (double)cache.Instructions / std::max<uint64_t>(cache.Dispatches, 1), (unsigned long long)cache.Rewrites);
+	}
+}
+
+static void WriteJson(std::ostream& out)
+{
+	out << "{\n  \"context\": {\n";
+	out << "    \"executable\": \"chip8_bench\",\n";
+	out << "    \"num_cpus\": " << std::max(1u, std::thread::hardware_concurrency()) << ",\n";
+#ifdef NDEBUG
+	out << "    \"library_build_type\": \"release\"\n";
+#else
+	out << "    \"library_build_type\": \"debug\"\n";
+#endif
+	out << "  },\n  \"benchmarks\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& result = results[i];
+		out << "    {\"name\": \"" << result.Name << "\", \"run_type\": \"iteration\", \"iterations\": " << result.Iterations
+			<< ", \"real_time\": " << result.NanosPerIteration << ", \"cpu_time\": " << result.NanosPerIteration
+			<< ", \"time_unit\": \"ns\", \"items_per_second\": " << result.ItemsPerSecond << "}"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+
+	out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::string romDir = CHIP8_ROM_DIR;
+	std::string outPath;
+	int64_t cycles = 20000000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--filter" && hasValue)
+			filter = argv[++i];
+		else if (arg == "--min-time" && hasValue)
+			minTime = atof(argv[++i]);
+		else if (arg == "--cycles" && hasValue)
+			cycles = atoll(argv[++i]);
+		else if (arg == "--roms" && hasValue)
+			romDir = argv[++i];
+		else if (arg == "--out" && hasValue)
+			outPath = argv[++i];
+		else
+		{
+			std::cerr << "usage: chip8_bench [--filter text] [--min-time seconds] [--cycles n] [--roms dir] [--out file]\n";
+			return 1;
+		}
+	}
+
+	BenchDecode();
+	BenchHandlers();
+	BenchDraw();
+	BenchRender();
+	BenchState(romDir);
+	BenchRunAhead(romDir);
+	BenchScan();
+	BenchObservers(romDir);
+	BenchRoms(romDir, cycles);
+
+	if (outPath.empty())
+	{
+		WriteJson(std::cout);
+	}
+	else
+	{
+		std::ofstream file(outPath);
+		WriteJson(file);
+	}
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <new>
+
+#include "Chip8Api.h"
+#include "Chip8.h"
+#include "Metrics.h"
+#include "Quirks.h"
+#include "Snapshot.h"
+
+static_assert(CHIP8_MEMORY_SIZE == MEMORY_SIZE, "memory size out of step with the core");
+static_assert(CHIP8_DISPLAY_WIDTH == DISPLAY_WIDTH && CHIP8_DISPLAY_HEIGHT == DISPLAY_HEIGHT, "display size out of step with the core");
+static_assert(CHIP8_PROFILE_XO_CHIP + 1 == (int)Profile::Count, "profiles out of step with the core");
+
+struct chip8
+{
+	Chip8 Cpu;
+	int CyclesPerFrame;
+};
+
+uint32_t chip8_api_version(void)
+{
+	return CHIP8_API_VERSION;
+}
+
+chip8* chip8_create(int profile)
+{
+	if (profile < 0 || profile >= (int)Profile::Count)
+		return nullptr;
+
+	chip8* machine = new (std::nothrow) chip8();
+	if (!machine)
+		return nullptr;
+
+	machine->Cpu.SetProfile((Profile)profile);
+	machine->CyclesPerFrame = ProfileCyclesPerFrame((Profile)profile);
+	return machine;
+}
+
+void chip8_destroy(chip8* machine)
+{
+	delete machine;
+}
+
+int chip8_load_rom(chip8* machine, const uint8_t* rom, size_t length)
+{
+	if (length > (size_t)(MEMORY_SIZE - PROGRAM_START))
+		return -1;
+
+	machine->Cpu.LoadRom((byte*)rom, (int)length);
+	return 0;
+}
+
+void chip8_seed(chip8* machine, uint32_t seed)
+{
+	machine->Cpu.SeedRandom(seed);
+}
+
+void chip8_set_cycles_per_frame(chip8* machine, int cycles)
+{
+	machine->CyclesPerFrame = cycles > 0 ? cycles : 1;
+}
+
+uint16_t chip8_step_cycles(chip8* machine, uint32_t cycles)
+{
+	for (uint32_t i = 0; i < cycles; i++)
+		machine->Cpu.ClockCycle();
+
+	return machine->Cpu.ProgramCounter;
+}
+
+void chip8_run_frames(chip8* machine, uint32_t frames)
+{
+	Metrics::Shard& shard = Metrics::Local();
+	for (uint32_t i = 0; i < frames; i++)
+		Metrics::RunFrame(machine->Cpu, machine->CyclesPerFrame, shard);
+}
+
+void chip8_run_frames_many(chip8* const* machines, size_t count, uint32_t frames)
+{
+	Metrics::Shard& shard = Metrics::Local();
+	for (size_t m = 0; m < count; m++)
+	{
+		for (uint32_t i = 0; i < frames; i++)
+			Metrics::RunFrame(machines[m]->Cpu, machines[m]->CyclesPerFrame, shard);
+	}
+}
+
+void chip8_set_keys(chip8* machine, uint16_t mask)
+{
+	for (int k = 0; k < 16; k++)
+		machine->Cpu.Keyboard[k] = (mask >> k) & 1;
+}
+
+uint8_t* chip8_memory(chip8* machine)
+{
+	return machine->Cpu.Memory;
+}
+
+uint8_t* chip8_registers(chip8* machine)
+{
+	return machine->Cpu.Registers;
+}
+
+uint16_t chip8_program_counter(const chip8* machine)
+{
+	return machine->Cpu.ProgramCounter;
+}
+
+const uint64_t* chip8_framebuffer(const chip8* machine)
+{
+	return &machine->Cpu.Graphics[0][0][0];
+}
+
+int chip8_high_resolution(const chip8* machine)
+{
+	return machine->Cpu.HighResolution;
+}
+
+size_t chip8_snapshot_size(void)
+{
+	return sizeof(SnapshotHeader) + sizeof(Chip8);
+}
+
+int chip8_snapshot(const chip8* machine, void* buffer, size_t size)
+{
+	if (size < chip8_snapshot_size())
+		return -1;
+
+	SnapshotHeader header = SnapshotHeader::For(machine->CyclesPerFrame);
+
+	memcpy(buffer, &header, sizeof(header));
+	memcpy((byte*)buffer + sizeof(header), &machine->Cpu, sizeof(Chip8));
+	Metrics::Local().Add(Metrics::SNAPSHOTS, 1);
+	return 0;
+}
+
+int chip8_restore(chip8* machine, const void* buffer, size_t size)
+{
+	if (size < chip8_snapshot_size())
+		return -1;
+
+	SnapshotHeader header;
+	memcpy(&header, buffer, sizeof(header));
+	if (!header.IsValid())
+		return -1;
+
+	memcpy(&machine->Cpu, (const byte*)buffer + sizeof(header), sizeof(Chip8));
+	machine->CyclesPerFrame = header.CyclesPerFrame;
+	Metrics::Local().Add(Metrics::RESTORES, 1);
+	return 0;
+}
+
+size_t chip8_metrics(char* buffer, size_t size)
+{
+	std::string text = Metrics::Scrape();
+	if (buffer && size > 0)
+	{
+		size_t copied = std::min(size - 1, text.size());
+		memcpy(buffer, text.data(), copied);
+		buffer[copied] = 0;
+	}
+
+	return text.size();
+}
+
+int chip8_metrics_serve(const char* endpoint)
+{
+	return Metrics::Serve(endpoint) ? 0 : -1;
+}
+
+int chip8_metrics_file(const char* path, int interval_ms)
+{
+	return Metrics::StartFile(path, interval_ms, 1 << 20) ? 0 : -1;
+}
+
+void chip8_metrics_stop(void)
+{
+	Metrics::Stop();
+}
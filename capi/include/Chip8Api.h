@@ -0,0 +1,90 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Plain C interface to the core for embedding in other tools and for loading from Python through
+// ctypes. Nothing here allocates after chip8_create, and the memory and framebuffer pointers
+// point straight into the machine, they stay valid until chip8_destroy.
+
+#if defined(_WIN32)
+#ifdef CHIP8_API_BUILD
+#define CHIP8_API __declspec(dllexport)
+#else
+#define CHIP8_API __declspec(dllimport)
+#endif
+#else
+#define CHIP8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a signature or the snapshot layout changes
+#define CHIP8_API_VERSION 1
+
+// Quirk profiles, the same order as the Profile enum
+#define CHIP8_PROFILE_COSMAC_VIP 0
+#define CHIP8_PROFILE_MODERN 1
+#define CHIP8_PROFILE_SUPER_CHIP 2
+#define CHIP8_PROFILE_XO_CHIP 3
+
+#define CHIP8_MEMORY_SIZE 0x10000
+#define CHIP8_DISPLAY_WIDTH 128
+#define CHIP8_DISPLAY_HEIGHT 64
+#define CHIP8_DISPLAY_PLANES 2
+
+typedef struct chip8 chip8;
+
+CHIP8_API uint32_t chip8_api_version(void);
+
+// Returns NULL for an unknown profile. Cycles per frame start at the profile's default.
+CHIP8_API chip8* chip8_create(int profile);
+CHIP8_API void chip8_destroy(chip8* machine);
+
+// Returns 0, or -1 if the rom doesn't fit in memory
+CHIP8_API int chip8_load_rom(chip8* machine, const uint8_t* rom, size_t length);
+CHIP8_API void chip8_seed(chip8* machine, uint32_t seed);
+CHIP8_API void chip8_set_cycles_per_frame(chip8* machine, int cycles);
+
+// Runs cycles instructions without ticking the timers, returns the program counter after
+CHIP8_API uint16_t chip8_step_cycles(chip8* machine, uint32_t cycles);
+CHIP8_API void chip8_run_frames(chip8* machine, uint32_t frames);
+
+// Runs frames on each of count machines, one call for a whole population. A machine blocked on
+// a key or a halt at the start of a frame has the frame skipped, which ends the same way.
+CHIP8_API void chip8_run_frames_many(chip8* const* machines, size_t count, uint32_t frames);
+
+// Bit k holds key k down
+CHIP8_API void chip8_set_keys(chip8* machine, uint16_t mask);
+
+// CHIP8_MEMORY_SIZE bytes, writable
+CHIP8_API uint8_t* chip8_memory(chip8* machine);
+
+// Sixteen V registers, writable
+CHIP8_API uint8_t* chip8_registers(chip8* machine);
+CHIP8_API uint16_t chip8_program_counter(const chip8* machine);
+
+// Both planes as CHIP8_DISPLAY_HEIGHT rows of two native endian words, leftmost pixel in the
+// highest bit. Lo-res games only use the first word of the top 32 rows.
+CHIP8_API const uint64_t* chip8_framebuffer(const chip8* machine);
+CHIP8_API int chip8_high_resolution(const chip8* machine);
+
+// A snapshot is chip8_snapshot_size() bytes and only loads back into the same build of the
+// library. Both return 0, or -1 if the buffer is too small or isn't a snapshot from this build.
+CHIP8_API size_t chip8_snapshot_size(void);
+CHIP8_API int chip8_snapshot(const chip8* machine, void* buffer, size_t size);
+CHIP8_API int chip8_restore(chip8* machine, const void* buffer, size_t size);
+
+// Counters for every machine run through chip8_run_frames and the snapshots, in the Prometheus
+// text format. Writes at most size bytes with the terminator and returns the full length, like
+// snprintf. The exports run on background threads, serve takes a port on 127.0.0.1 or a Unix
+// socket path, and both return 0 or -1.
+CHIP8_API size_t chip8_metrics(char* buffer, size_t size);
+CHIP8_API int chip8_metrics_serve(const char* endpoint);
+CHIP8_API int chip8_metrics_file(const char* path, int interval_ms);
+CHIP8_API void chip8_metrics_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+#include "Harness.h"
+#include "Lockstep.h"
+#include "Quirks.h"
+#include "Sha1.h"
+
+// Runs every bundled rom under every quirk profile with a fixed seed and scripted input, and
+// checks a hash of the machine state at a few frames against the checked-in golden file.
+// Any mismatch writes the frame it happened on out as a PBM image next to the golden file.
+// With --lockstep it instead runs the same roms and input through another engine side by side
+// with the reference one, see Lockstep.h, and reports the first divergence in each.
+//
+//   chip8_conformance [--update] [--roms dir] [--golden file] [--dump dir] [--lockstep engine [--block n]]
+
+#ifndef CHIP8_ROM_DIR
+#define CHIP8_ROM_DIR "roms"
+#endif
+
+#ifndef CHIP8_GOLDEN_FILE
+#define CHIP8_GOLDEN_FILE "golden.txt"
+#endif
+
+namespace fs = std::filesystem;
+
+const uint32_t RANDOM_SEED = 0xC8C8C8C8;
+const int CHECKPOINTS[] = {30, 120, 600};
+
+// Only state a program can observe goes into the hash, the debugger bookkeeping stays out of it
+static std::string HashState(const Chip8& cpu)
+{
+	std::vector<byte> state;
+	auto append = [&](const void* data, size_t len)
+	{
+		const byte* bytes = (const byte*)data;
+		state.insert(state.end(), bytes, bytes + len);
+	};
+
+	append(cpu.Memory, sizeof(cpu.Memory));
+	append(cpu.Registers, sizeof(cpu.Registers));
+	append(&cpu.IndexRegister, sizeof(cpu.IndexRegister));
+	append(&cpu.ProgramCounter, sizeof(cpu.ProgramCounter));
+	append(&cpu.StackPointer, sizeof(cpu.StackPointer));
+	append(cpu.Stack, sizeof(cpu.Stack));
+	append(&cpu.DelayTimer, sizeof(cpu.DelayTimer));
+	append(&cpu.SoundTimer, sizeof(cpu.SoundTimer));
+	append(&cpu.HighResolution, sizeof(cpu.HighResolution));
+	append(&cpu.PlaneMask, sizeof(cpu.PlaneMask));
+	append(cpu.Graphics, sizeof(cpu.Graphics));
+
+	return Sha1(state.data(), state.size());
+}
+
+static void DumpFrame(const Chip8& cpu, const fs::path& path)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary);
+	file << "P1\n" << cpu.DisplayWidth() << ' ' << cpu.DisplayHeight() << '\n';
+
+	for (int y = 0; y < cpu.DisplayHeight(); y++)
+	{
+		for (int x = 0; x < cpu.DisplayWidth(); x++)
+			file << (cpu.GetPixel(x, y) ? '1' : '0');
+		file << '\n';
+	}
+}
+
+// Golden lines are "rom profile frame hash", keyed here by everything but the hash
+static std::map<std::string, std::string> ReadGolden(const std::string& path)
+{
+	std::map<std::string, std::string> golden;
+	std::ifstream file(path);
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream fields(line);
+		std::string rom, profile, frame, hash;
+		if (fields >> rom >> profile >> frame >> hash)
+			golden[rom + ' ' + profile + ' ' + frame] = hash;
+	}
+
+	return golden;
+}
+
+static int RunLockstep(const std::vector<fs::path>& roms, const std::string& engineName, int blockSize)
+{
+	const Engine* engine = FindEngine(engineName);
+	if (!engine)
+	{
+		std::cerr << "unknown engine " << engineName << ", one of:";
+		for (int i = 0; i < ENGINE_COUNT; i++)
+			std::cerr << ' ' << ENGINES[i].Name;
+		std::cerr << "\n";
+		return 1;
+	}
+
+	const int frames = CHECKPOINTS[ARRAYLEN(CHECKPOINTS) - 1];
+	int checked = 0, diverged = 0;
+	uint64_t instructions = 0;
+	auto lockstep = std::make_unique<Lockstep>(ENGINES[0], *engine);
+	lockstep->BlockSize = blockSize;
+
+	for (const fs::path& path : roms)
+	{
+		std::string romName = path.filename().u8string();
+		std::vector<byte> rom = ReadFile(path);
+
+		for (int p = 0; p < (int)Profile::Count; p++)
+		{
+			Profile profile = (Profile)p;
+			lockstep->LoadRom(rom.data(), (int)rom.size(), profile, RANDOM_SEED);
+
+			for (int frame = 0; frame < frames; frame++)
+			{
+				lockstep->SetKeys(ScriptedKeys(frame));
+				if (!lockstep->RunFrame(ProfileCyclesPerFrame(profile)))
+				{
+					std::cerr << "DIVERGED " << romName << ' ' << p << " (" << ProfileName(profile) << ") "
+						<< lockstep->Divergence();
+					diverged++;
+					break;
+				}
+			}
+
+			instructions += lockstep->Instructions();
+			checked++;
+		}
+	}
+
+	std::cout << checked - diverged << "/" << checked << " runs of " << engine->Name << " match " << ENGINES[0].Name
+		<< " over " << instructions << " instructions\n";
+	return diverged ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+	std::string romDir = CHIP8_ROM_DIR;
+	std::string goldenPath = CHIP8_GOLDEN_FILE;
+	std::string dumpDir;
+	std::string lockstepEngine;
+	int blockSize = 1;
+	bool update = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--update")
+			update = true;
+		else if (arg == "--roms" && hasValue)
+			romDir = argv[++i];
+		else if (arg == "--golden" && hasValue)
+			goldenPath = argv[++i];
+		else if (arg == "--dump" && hasValue)
+			dumpDir = argv[++i];
+		else if (arg == "--lockstep" && hasValue)
+			lockstepEngine = argv[++i];
+		else if (arg == "--block" && hasValue)
+			blockSize = std::max(1, std::stoi(argv[++i]));
+		else
+		{
+			std::cerr << "usage: chip8_conformance [--update] [--roms dir] [--golden file] [--dump dir] [--lockstep engine [--block n]]\n";
+			return 1;
+		}
+	}
+
+	if (dumpDir.empty())
+		dumpDir = fs::path(goldenPath).parent_path().u8string();
+
+	std::vector<fs::path> roms;
+	std::error_code error;
+	for (const auto& entry : fs::directory_iterator(romDir, error))
+	{
+		std::error_code entryError;
+		if (entry.is_regular_file(entryError) && entry.path().extension().empty())
+			roms.push_back(entry.path());
+	}
+	std::sort(roms.begin(), roms.end());
+
+	if (roms.empty())
+	{
+		std::cerr << "no roms found in " << romDir << "\n";
+		return 1;
+	}
+
+	if (!lockstepEngine.empty())
+		return RunLockstep(roms, lockstepEngine, blockSize);
+
+	std::map<std::string, std::string> golden = update ? std::map<std::string, std::string>() : ReadGolden(goldenPath);
+	std::ostringstream updated;
+	updated << "# rom profile frame sha1, regenerate with chip8_conformance --update\n";
+
+	int checked = 0, failed = 0, missing = 0;
+	auto cpu = std::make_unique<Chip8>();
+
+	for (const fs::path& path : roms)
+	{
+		std::string romName = path.filename().u8string();
+		std::vector<byte> rom = ReadFile(path);
+
+		for (int p = 0; p < (int)Profile::Count; p++)
+		{
+			Profile profile = (Profile)p;
+			int cycles = ProfileCyclesPerFrame(profile);
+
+			cpu->SetProfile(profile);
+			cpu->LoadRom(rom.data(), (int)rom.size());
+			cpu->SeedRandom(RANDOM_SEED);
+
+			int frame = 0;
+			for (int checkpoint : CHECKPOINTS)
+			{
+				while (frame < checkpoint)
+				{
+					ScriptInput(*cpu, frame++);
+					cpu->RunFrame(cycles);
+				}
+
+				std::string key = romName + ' ' + std::to_string(p) + ' ' + std::to_string(frame);
+				std::string hash = HashState(*cpu);
+				updated << key << ' ' << hash << '\n';
+				checked++;
+
+				if (update)
+					continue;
+
+				auto it = golden.find(key);
+				if (it == golden.end())
+				{
+					std::cerr << "MISSING " << key << " (" << ProfileName(profile) << ")\n";
+					missing++;
+				}
+				else if (it->second != hash)
+				{
+					fs::path image = fs::path(dumpDir) / (romName + "-" + std::to_string(p) + "-" + std::to_string(frame) + ".pbm");
+					DumpFrame(*cpu, image);
+
+					std::cerr << "FAIL " << key << " (" << ProfileName(profile) << "), frame written to " << image.u8string() << "\n";
+					failed++;
+				}
+			}
+		}
+	}
+
+	if (update)
+	{
+		std::ofstream file(goldenPath, std::ios::out | std::ios::trunc);
+		file << updated.str();
+		std::cout << "wrote " << checked << " golden hashes to " << goldenPath << "\n";
+		return 0;
+	}
+
+	std::cout << checked - failed - missing << "/" << checked << " checkpoints match";
+	if (missing)
+		std::cout << ", " << missing << " missing";
+	std::cout << "\n";
+
+	return failed || missing ? 1 : 0;
+}
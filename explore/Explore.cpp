@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Chip8.h"
+#include "Harness.h"
+#include "Interpreter.h"
+#include "Quirks.h"
+
+// Explores a rom's input space looking for faults, see Chip8::Faults. Starting from the rom
+// freshly loaded, every worker picks a saved state, holds random keys down for a stretch of
+// frames from there, and keeps the state it ends in if it ran an instruction nothing had run
+// before or put a new picture on screen. A state that faults has its whole input written out as
+// a movie that chip8_headless replays with the same profile, cycles and seed.
+//
+//   chip8_explore rom [--profile 0-3] [--cycles n] [--seed n] [--seconds n] [--threads n]
+//       [--corpus n] [--max-frames n] [--out dir]
+
+namespace fs = std::filesystem;
+
+// Coverage is a byte per hash of an address and the instruction at it, so code that rewrites
+// itself counts again
+const int COVERAGE_SIZE = 1 << 16;
+
+struct Coverage
+{
+	byte Hit[COVERAGE_SIZE];
+	std::vector<word> Touched;
+};
+
+// Counts into the worker's own map, merged into the shared one after each run
+struct CoverageObserver : NullObserver
+{
+	static thread_local Coverage* Current;
+
+	static void OnFetch(const Chip8& cpu, word address, word code)
+	{
+		word key = (word)(address ^ (code * 0x9E37u));
+		if (!Current->Hit[key])
+		{
+			Current->Hit[key] = 1;
+			Current->Touched.push_back(key);
+		}
+	}
+};
+
+thread_local Coverage* CoverageObserver::Current = nullptr;
+
+struct Seed
+{
+	std::unique_ptr<Chip8> State;
+	std::vector<word> Inputs;
+};
+
+struct Explorer
+{
+	Profile QuirkProfile;
+	int Cycles;
+	uint32_t RandomSeed;
+	int CorpusLimit;
+	int MaxFrames;
+	fs::path OutDir;
+
+	std::mutex lock;
+	std::vector<Seed> corpus;
+	std::vector<std::atomic<byte>> coverage;
+	std::unordered_set<uint64_t> screens;
+	std::unordered_set<uint32_t> faults;
+	int edges = 0;
+
+	std::atomic<uint64_t> runs{0};
+	std::atomic<uint64_t> frames{0};
+	std::atomic<bool> stopping{false};
+
+	Explorer() : coverage(COVERAGE_SIZE) { }
+};
+
+// FNV-1a over what is on screen
+static uint64_t HashScreen(const Chip8& cpu)
+{
+	uint64_t hash = 0xCBF29CE484222325ull ^ cpu.HighResolution;
+	const byte* bytes = (const byte*)cpu.Graphics;
+	for (size_t i = 0; i < sizeof(cpu.Graphics); i++)
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	return hash;
+}
+
+static void WriteMovie(const Explorer& explorer, const fs::path& path, const std::vector<word>& inputs, const Chip8& cpu)
+{
+	std::ofstream file(path);
+	file << "# chip8_headless rom --profile " << (int)explorer.QuirkProfile << " --cycles " << explorer.Cycles
+		<< " --seed " << explorer.RandomSeed << " --movie " << path.filename().u8string() << "\n";
+	file << "# faulted at " << std::hex << cpu.FaultAddress << std::dec << ":";
+	for (int kind = 0; kind < FAULT_KINDS; kind++)
+	{
+		if (cpu.Faults & (1 << kind))
+			file << " " << FaultName(kind);
+	}
+	file << "\n";
+
+	char line[8];
+	for (word mask : inputs)
+	{
+		snprintf(line, sizeof(line), "%04X\n", mask);
+		file << line;
+	}
+}
+
+// Key masks for the next stretch, each held for a while the way a player would. Mostly one key
+// at a time, sometimes none or a random handful.
+static void ChooseInputs(std::mt19937& random, int length, std::vector<word>& out)
+{
+	while ((int)out.size() < length)
+	{
+		word mask;
+		int choice = random() % 8;
+		if (choice == 0)
+			mask = 0;
+		else if (choice == 1)
+			mask = (word)random();
+		else
+			mask = (word)(1 << (random() % 16));
+
+		int hold = 1 + random() % 20;
+		for (int i = 0; i < hold && (int)out.size() < length; i++)
+			out.push_back(mask);
+	}
+}
+
+static void Work(Explorer& explorer, uint32_t workerSeed)
+{
+	std::mt19937 random(workerSeed);
+	auto local = std::make_unique<Coverage>();
+	memset(local->Hit, 0, sizeof(local->Hit));
+	CoverageObserver::Current = local.get();
+
+	auto cpu = std::make_unique<Chip8>();
+	std::vector<word> inputs;
+	std::vector<word> stretch;
+
+	while (!explorer.stopping)
+	{
+		{
+			std::lock_guard<std::mutex> guard(explorer.lock);
+			const Seed& parent = explorer.corpus[random() % explorer.corpus.size()];
+			*cpu = *parent.State;
+			inputs = parent.Inputs;
+		}
+
+		if ((int)inputs.size() >= explorer.MaxFrames)
+			continue;
+
+		stretch.clear();
+		ChooseInputs(random, std::min(1 + (int)(random() % 60), explorer.MaxFrames - (int)inputs.size()), stretch);
+
+		int ran = 0;
+		for (word mask : stretch)
+		{
+			for (int k = 0; k < 16; k++)
+				cpu->Keyboard[k] = (mask >> k) & 1;
+
+			VisitProfile(cpu->QuirkProfile, [&](auto quirks) { return Interpreter<decltype(quirks), CoverageObserver>::RunFrame(*cpu, explorer.Cycles); });
+			inputs.push_back(mask);
+			ran++;
+
+			if (cpu->Faults)
+				break;
+		}
+
+		explorer.runs++;
+		explorer.frames += ran;
+
+		bool interesting = false;
+		int newEdges = 0;
+		for (word key : local->Touched)
+		{
+			if (!explorer.coverage[key].exchange(1, std::memory_order_relaxed))
+				newEdges++;
+			local->Hit[key] = 0;
+		}
+		local->Touched.clear();
+		interesting = newEdges > 0;
+
+		uint64_t screen = HashScreen(*cpu);
+
+		std::lock_guard<std::mutex> guard(explorer.lock);
+		explorer.edges += newEdges;
+
+		if (cpu->Faults)
+		{
+			// One movie per kind of fault at each address, the same crash found again adds nothing
+			uint32_t key = (uint32_t)cpu->FaultAddress << 8 | cpu->Faults;
+			if (explorer.faults.insert(key).second)
+			{
+				char name[48];
+				snprintf(name, sizeof(name), "fault-%04X-%02X.txt", cpu->FaultAddress, cpu->Faults);
+				WriteMovie(explorer, explorer.OutDir / name, inputs, *cpu);
+
+				std::cout << "fault at " << std::hex << cpu->FaultAddress << std::dec << " after " << inputs.size() << " frames:";
+				for (int kind = 0; kind < FAULT_KINDS; kind++)
+				{
+					if (cpu->Faults & (1 << kind))
+						std::cout << " " << FaultName(kind);
+				}
+				std::cout << ", " << (explorer.OutDir / name).u8string() << std::endl;
+			}
+			continue;
+		}
+
+		interesting |= explorer.screens.insert(screen).second;
+		if (!interesting)
+			continue;
+
+		// Past the limit a new state takes the place of a random old one, never the starting state
+		Seed seed = {std::make_unique<Chip8>(*cpu), inputs};
+		if ((int)explorer.corpus.size() < explorer.CorpusLimit)
+			explorer.corpus.push_back(std::move(seed));
+		else
+			explorer.corpus[1 + random() % (explorer.corpus.size() - 1)] = std::move(seed);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string romPath;
+	std::string outDir = ".";
+	int profileIndex = (int)Profile::Modern;
+	int cycles = 0;
+	uint32_t seed = 0;
+	double seconds = 10;
+	int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+	int corpusLimit = 512;
+	int maxFrames = 36000;
+	bool usage = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--profile" && hasValue)
+			profileIndex = std::stoi(argv[++i]);
+		else if (arg == "--cycles" && hasValue)
+			cycles = std::stoi(argv[++i]);
+		else if (arg == "--seed" && hasValue)
+			seed = (uint32_t)std::stoul(argv[++i], nullptr, 0);
+		else if (arg == "--seconds" && hasValue)
+			seconds = std::stod(argv[++i]);
+		else if (arg == "--threads" && hasValue)
+			threads = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--corpus" && hasValue)
+			corpusLimit = std::max(2, std::stoi(argv[++i]));
+		else if (arg == "--max-frames" && hasValue)
+			maxFrames = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--out" && hasValue)
+			outDir = argv[++i];
+		else if (romPath.empty() && arg[0] != '-')
+			romPath = arg;
+		else
+			usage = true;
+	}
+
+	if (usage || romPath.empty() || profileIndex < 0 || profileIndex >= (int)Profile::Count)
+	{
+		std::cerr << "usage: chip8_explore rom [--profile 0-3] [--cycles n] [--seed n] [--seconds n] [--threads n]\n"
+			"    [--corpus n] [--max-frames n] [--out dir]\n";
+		return 1;
+	}
+
+	std::vector<byte> rom = ReadFile(romPath);
+	if (rom.empty())
+	{
+		std::cerr << "could not read " << romPath << "\n";
+		return 1;
+	}
+
+	std::error_code error;
+	fs::create_directories(outDir, error);
+
+	Explorer explorer;
+	explorer.QuirkProfile = (Profile)profileIndex;
+	explorer.Cycles = cycles > 0 ? cycles : ProfileCyclesPerFrame(explorer.QuirkProfile);
+	explorer.RandomSeed = seed;
+	explorer.CorpusLimit = corpusLimit;
+	explorer.MaxFrames = maxFrames;
+	explorer.OutDir = outDir;
+
+	// Seeded the same way chip8_headless --seed does it, so the movies replay exactly
+	Seed start = {std::make_unique<Chip8>(), {}};
+	start.State->SetProfile(explorer.QuirkProfile);
+	start.State->LoadRom(rom.data(), (int)rom.size());
+	start.State->SeedRandom(seed);
+	explorer.corpus.push_back(std::move(start));
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++)
+		workers.emplace_back(Work, std::ref(explorer), seed * 7919 + t + 1);
+
+	auto begin = std::chrono::steady_clock::now();
+	auto elapsed = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(); };
+
+	auto report = [&]
+	{
+		std::lock_guard<std::mutex> guard(explorer.lock);
+		std::cout << (int)elapsed() << "s: " << explorer.runs << " runs, " << explorer.frames << " frames, "
+			<< explorer.edges << " coverage, " << explorer.screens.size() << " screens, " << explorer.corpus.size() << " states, "
+			<< explorer.faults.size() << " faults" << std::endl;
+	};
+
+	while (elapsed() < seconds)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min(1000, (int)((seconds - elapsed()) * 1000) + 1)));
+		report();
+	}
+
+	explorer.stopping = true;
+	for (std::thread& worker : workers)
+		worker.join();
+
+	return explorer.faults.empty() ? 0 : 2;
+}
@@ -0,0 +1,319 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Chip8.h"
+#include "Harness.h"
+#include "Lockstep.h"
+#include "Metrics.h"
+#include "Quirks.h"
+#include "Recorder.h"
+#include "Remote.h"
+#include "SharedExport.h"
+#include "Upscaler.h"
+
+// Runs a rom with no window or audio for a fixed number of frames, as fast as it will go.
+// Optionally records the display, which is the way to make a GIF or video from a script. With
+// --serve it runs nothing itself and takes remote control requests on the socket instead (see
+// Remote.h) until the client closes the connection, the rom is optional then. A movie holds the
+// keys down frame by frame, and --lockstep plays the run on another engine side by side with the
+// reference one and stops at the first place they differ, see Lockstep.h. --metrics serves
+// Prometheus counters for the run on a local port or socket and --metrics-file appends them to
+// a file every interval, see Metrics.h. --share publishes every frame to a shared memory segment
+// for other processes to watch, see SharedExport.h, and --realtime holds the run to 60 frames a
+// second so they can keep up.
+//
+//   chip8_headless rom [--frames n] [--profile 0-3] [--cycles n] [--seed n] [--movie file]
+//       [--record out.gif|out.y4m] [--scale n] [--serve socket] [--lockstep engine [--block n]]
+//       [--metrics port|socket] [--metrics-file path [--metrics-interval ms]]
+//       [--share name [--realtime]]
+
+namespace fs = std::filesystem;
+
+// One hex key mask per line and a line per frame, bit k holds key k down. Lines starting with #
+// are comments.
+static std::vector<word> ReadMovie(const fs::path& path)
+{
+	std::ifstream file(path);
+	std::vector<word> movie;
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		if (!line.empty() && line[0] != '#')
+			movie.push_back((word)std::stoul(line, nullptr, 16));
+	}
+
+	return movie;
+}
+
+int main(int argc, char** argv)
+{
+	std::string romPath;
+	std::string recordPath;
+	std::string servePath;
+	std::string moviePath;
+	std::string lockstepEngine;
+	std::string metricsEndpoint;
+	std::string metricsPath;
+	int metricsInterval = 1000;
+	std::string shareName;
+	bool realtime = false;
+	int frames = 600;
+	bool framesGiven = false;
+	int blockSize = 1;
+	int profileIndex = (int)Profile::Modern;
+	int cycles = 0;
+	int scale = 4;
+	uint32_t seed = 0;
+	bool seeded = false;
+	bool usage = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--frames" && hasValue)
+		{
+			frames = std::stoi(argv[++i]);
+			framesGiven = true;
+		}
+		else if (arg == "--profile" && hasValue)
+			profileIndex = std::stoi(argv[++i]);
+		else if (arg == "--cycles" && hasValue)
+			cycles = std::stoi(argv[++i]);
+		else if (arg == "--seed" && hasValue)
+		{
+			seed = (uint32_t)std::stoul(argv[++i], nullptr, 0);
+			seeded = true;
+		}
+		else if (arg == "--record" && hasValue)
+			recordPath = argv[++i];
+		else if (arg == "--scale" && hasValue)
+			scale = std::stoi(argv[++i]);
+		else if (arg == "--serve" && hasValue)
+			servePath = argv[++i];
+		else if (arg == "--movie" && hasValue)
+			moviePath = argv[++i];
+		else if (arg == "--lockstep" && hasValue)
+			lockstepEngine = argv[++i];
+		else if (arg == "--block" && hasValue)
+			blockSize = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--metrics" && hasValue)
+			metricsEndpoint = argv[++i];
+		else if (arg == "--metrics-file" && hasValue)
+			metricsPath = argv[++i];
+		else if (arg == "--metrics-interval" && hasValue)
+			metricsInterval = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--share" && hasValue)
+			shareName = argv[++i];
+		else if (arg == "--realtime")
+			realtime = true;
+		else if (romPath.empty() && arg[0] != '-')
+			romPath = arg;
+		else
+			usage = true;
+	}
+
+	if (!servePath.empty() && !lockstepEngine.empty())
+		usage = true;
+
+	if (usage || (romPath.empty() && servePath.empty()) || profileIndex < 0 || profileIndex >= (int)Profile::Count)
+	{
+		std::cerr << "usage: chip8_headless rom [--frames n] [--profile 0-3] [--cycles n] [--seed n] [--movie file]\n"
+			"    [--record out.gif|out.y4m] [--scale n] [--serve socket] [--lockstep engine [--block n]]\n"
+			"    [--metrics port|socket] [--metrics-file path [--metrics-interval ms]]\n"
+			"    [--share name [--realtime]]\n";
+		return 1;
+	}
+
+	std::vector<word> movie;
+	if (!moviePath.empty())
+	{
+		movie = ReadMovie(moviePath);
+		if (!framesGiven)
+			frames = (int)movie.size();
+	}
+
+	auto keysFor = [&](int frame) { return frame < (int)movie.size() ? movie[frame] : (word)0; };
+
+	std::vector<byte> rom = romPath.empty() ? std::vector<byte>() : ReadFile(romPath);
+	if (!romPath.empty() && rom.empty())
+	{
+		std::cerr << "could not read " << romPath << "\n";
+		return 1;
+	}
+
+	Profile profile = (Profile)profileIndex;
+	if (cycles <= 0)
+		cycles = ProfileCyclesPerFrame(profile);
+
+	auto cpu = std::make_unique<Chip8>();
+	cpu->SetProfile(profile);
+	if (!rom.empty())
+		cpu->LoadRom(rom.data(), (int)rom.size());
+	if (seeded)
+		cpu->SeedRandom(seed);
+
+	// Same colours the frontend starts with
+	const uint32_t palette[4] =
+	{
+		Upscaler::PackColor(0, 0, 0),
+		Upscaler::PackColor(255, 255, 255),
+		Upscaler::PackColor(170, 170, 170),
+		Upscaler::PackColor(85, 85, 85)
+	};
+
+	Recorder recorder;
+	if (!recordPath.empty() && !recorder.Start(recordPath, Recorder::FormatForPath(recordPath), palette, scale))
+	{
+		std::cerr << "could not open " << recordPath << "\n";
+		return 1;
+	}
+
+	SharedExport shared;
+	if (!shareName.empty() && !shared.Open(shareName))
+	{
+		std::cerr << "could not publish to " << shareName << "\n";
+		return 1;
+	}
+
+	auto frameDue = std::chrono::steady_clock::now();
+
+	// Nothing here is real time, so rather than have frames dropped the loop waits on the encoder
+	auto capture = [&](const Chip8& shown)
+	{
+		while (recorder.Backlog() >= Recorder::QUEUE_FRAMES)
+			std::this_thread::yield();
+
+		recorder.Capture(shown);
+		shared.Publish(shown);
+
+		if (realtime)
+		{
+			frameDue += std::chrono::microseconds(1000000 / 60);
+			std::this_thread::sleep_until(frameDue);
+		}
+	};
+
+	if (!metricsEndpoint.empty() && !Metrics::Serve(metricsEndpoint))
+	{
+		std::cerr << "could not serve metrics on " << metricsEndpoint << "\n";
+		return 1;
+	}
+
+	if (!metricsPath.empty() && !Metrics::StartFile(metricsPath, metricsInterval, 1 << 20))
+	{
+		std::cerr << "could not open " << metricsPath << "\n";
+		return 1;
+	}
+
+	bool counting = !metricsEndpoint.empty() || !metricsPath.empty();
+	Metrics::Shard& shard = Metrics::Local();
+
+	std::unique_ptr<Lockstep> lockstep;
+
+	if (!servePath.empty())
+	{
+		RemoteServer server;
+		if (!server.Listen(servePath))
+		{
+			std::cerr << "could not listen on " << servePath << "\n";
+			return 1;
+		}
+
+		std::cout << "listening on " << servePath << std::endl;
+
+		std::unordered_set<int> breakpoints;
+		frames = 0;
+		server.OnFrame = [&](const Chip8& shown)
+		{
+			frames++;
+			capture(shown);
+		};
+
+		while (!(server.Poll(*cpu, breakpoints, cycles) & RemoteServer::DISCONNECTED))
+			server.Wait(-1);
+	}
+	else if (!lockstepEngine.empty())
+	{
+		const Engine* engine = FindEngine(lockstepEngine);
+		if (!engine)
+		{
+			std::cerr << "unknown engine " << lockstepEngine << "\n";
+			return 1;
+		}
+
+		lockstep = std::make_unique<Lockstep>(ENGINES[0], *engine);
+		lockstep->BlockSize = blockSize;
+		lockstep->LoadRom(rom.data(), (int)rom.size(), profile, seed);
+
+		for (int frame = 0; frame < frames; frame++)
+		{
+			lockstep->SetKeys(keysFor(frame));
+			if (!lockstep->RunFrame(cycles))
+			{
+				std::cerr << lockstep->Divergence();
+				return 2;
+			}
+
+			capture(lockstep->Reference());
+		}
+
+		std::cout << engine->Name << " matched " << ENGINES[0].Name << " over " << lockstep->Instructions() << " instructions\n";
+	}
+	else
+	{
+		for (int frame = 0; frame < frames; frame++)
+		{
+			word keys = keysFor(frame);
+			for (int k = 0; k < 16 && !movie.empty(); k++)
+				cpu->Keyboard[k] = (keys >> k) & 1;
+
+			if (counting)
+				Metrics::RunFrame(*cpu, cycles, shard);
+			else
+				cpu->RunFrame(cycles);
+			capture(*cpu);
+		}
+	}
+
+	if (!recordPath.empty())
+	{
+		uint32_t dropped = recorder.DroppedFrames();
+		recorder.Stop();
+
+		if (recorder.Failed())
+		{
+			std::cerr << "error writing " << recordPath << "\n";
+			return 1;
+		}
+
+		std::cout << "recorded " << frames << " frames to " << recordPath;
+		if (dropped)
+			std::cout << ", " << dropped << " dropped";
+		std::cout << "\n";
+	}
+
+	Metrics::Stop();
+
+	const Chip8& finished = lockstep ? lockstep->Reference() : *cpu;
+	std::cout << ProfileName(profile) << ", pc " << std::hex << finished.ProgramCounter << std::dec << " after " << frames << " frames\n";
+
+	for (int kind = 0; kind < FAULT_KINDS; kind++)
+	{
+		if (finished.Faults & (1 << kind))
+			std::cout << "fault: " << FaultName(kind) << "\n";
+	}
+	if (finished.Faults)
+		std::cout << "first fault at " << std::hex << finished.FaultAddress << std::dec << "\n";
+
+	return 0;
+}
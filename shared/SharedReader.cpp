@@ -0,0 +1,112 @@
+#include <new>
+#include <string.h>
+#include <thread>
+
+#include "Chip8Shared.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct chip8_shared
+{
+	const chip8_shared_segment* Segment;
+};
+
+// A frame is written in well under a microsecond, this many tries only fail when the reader
+// keeps getting descheduled halfway through its copy
+const int READ_ATTEMPTS = 1000;
+
+#ifdef _WIN32
+
+chip8_shared* chip8_shared_open(const char* name) { return nullptr; }
+void chip8_shared_close(chip8_shared* shared) { }
+uint64_t chip8_shared_published(const chip8_shared* shared) { return 0; }
+int chip8_shared_read(const chip8_shared* shared, chip8_shared_state* out) { return -1; }
+int chip8_shared_closed(const chip8_shared* shared) { return 1; }
+
+#else
+
+chip8_shared* chip8_shared_open(const char* name)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(chip8_shared_segment))
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	void* mapped = mmap(nullptr, sizeof(chip8_shared_segment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (mapped == MAP_FAILED)
+		return nullptr;
+
+	const chip8_shared_segment* segment = (const chip8_shared_segment*)mapped;
+	if (segment->magic != CHIP8_SHARED_MAGIC || segment->version != CHIP8_SHARED_VERSION || segment->size != sizeof(chip8_shared_segment))
+	{
+		munmap(mapped, sizeof(chip8_shared_segment));
+		return nullptr;
+	}
+
+	chip8_shared* shared = new (std::nothrow) chip8_shared();
+	if (!shared)
+	{
+		munmap(mapped, sizeof(chip8_shared_segment));
+		return nullptr;
+	}
+
+	shared->Segment = segment;
+	return shared;
+}
+
+void chip8_shared_close(chip8_shared* shared)
+{
+	if (!shared)
+		return;
+
+	munmap((void*)shared->Segment, sizeof(chip8_shared_segment));
+	delete shared;
+}
+
+uint64_t chip8_shared_published(const chip8_shared* shared)
+{
+	return __atomic_load_n(&shared->Segment->sequence, __ATOMIC_ACQUIRE) / 2;
+}
+
+int chip8_shared_read(const chip8_shared* shared, chip8_shared_state* out)
+{
+	const chip8_shared_segment* segment = shared->Segment;
+
+	for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++)
+	{
+		uint64_t before = __atomic_load_n(&segment->sequence, __ATOMIC_ACQUIRE);
+		if (before & 1)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		memcpy(out, &segment->state, sizeof(*out));
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&segment->sequence, __ATOMIC_RELAXED) == before)
+			return 0;
+	}
+
+	return -1;
+}
+
+int chip8_shared_closed(const chip8_shared* shared)
+{
+	return (__atomic_load_n(&shared->Segment->flags, __ATOMIC_ACQUIRE) & CHIP8_SHARED_CLOSED) != 0;
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "Chip8Shared.h"
+
+// Watches an emulator publishing to shared memory, see Chip8Shared.h, and draws its display and
+// registers in the terminal. It reads at its own rate, frames published in between are skipped
+// and counted. Two rows of pixels go in each line of text.
+//
+//   chip8_shared_view [name] [--hz n] [--once]
+
+static void Draw(const chip8_shared_state& state, uint64_t published, uint64_t skipped)
+{
+	int width = state.high_resolution ? 128 : 64;
+	int height = state.high_resolution ? 64 : 32;
+
+	auto pixel = [&](int x, int y)
+	{
+		uint64_t bits = state.graphics[0][y][x / 64] | state.graphics[1][y][x / 64];
+		return (bits >> (63 - x % 64)) & 1;
+	};
+
+	const char* blocks[4] = {" ", "\u2580", "\u2584", "\u2588"};
+
+	std::string text;
+	for (int y = 0; y < height; y += 2)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int cell = (int)pixel(x, y) | (int)pixel(x, y + 1) << 1;
+			text += blocks[cell];
+		}
+		text += "\n";
+	}
+
+	char line[160];
+	snprintf(line, sizeof(line), "frame %u, published %llu, skipped %llu\n", state.frame, (unsigned long long)published, (unsigned long long)skipped);
+	text += line;
+
+	snprintf(line, sizeof(line), "pc %04X  i %04X  sp %d  dt %3d  st %3d  keys %04X",
+		state.program_counter, state.index_register, state.stack_pointer, state.delay_timer, state.sound_timer, state.keys);
+	text += line;
+	if (state.faults)
+	{
+		snprintf(line, sizeof(line), "  faults %02X", state.faults);
+		text += line;
+	}
+	text += "\n";
+
+	for (int reg = 0; reg < 16; reg++)
+	{
+		snprintf(line, sizeof(line), "v%X %02X%s", reg, state.registers[reg], reg == 15 ? "\n" : " ");
+		text += line;
+	}
+
+	std::cout << text << std::flush;
+}
+
+int main(int argc, char** argv)
+{
+	std::string name = "/chip8";
+	double hz = 30;
+	bool once = false;
+	bool usage = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--hz" && hasValue)
+			hz = std::max(0.1, std::stod(argv[++i]));
+		else if (arg == "--once")
+			once = true;
+		else if (arg[0] != '-')
+			name = arg;
+		else
+			usage = true;
+	}
+
+	if (usage)
+	{
+		std::cerr << "usage: chip8_shared_view [name] [--hz n] [--once]\n";
+		return 1;
+	}
+
+	chip8_shared* shared = chip8_shared_open(name.c_str());
+	if (!shared)
+	{
+		std::cerr << "nothing published as " << name << "\n";
+		return 1;
+	}
+
+	auto interval = std::chrono::duration<double>(1.0 / hz);
+	uint64_t seen = 0;
+	chip8_shared_state state;
+
+	while (true)
+	{
+		uint64_t published = chip8_shared_published(shared);
+		if (published != seen || once)
+		{
+			if (chip8_shared_read(shared, &state) != 0)
+				continue;
+
+			uint64_t skipped = seen && published > seen + 1 ? published - seen - 1 : 0;
+			seen = published;
+
+			if (!once)
+				std::cout << "\x1b[H\x1b[2J";
+			Draw(state, published, skipped);
+		}
+
+		if (once || chip8_shared_closed(shared))
+			break;
+
+		std::this_thread::sleep_for(interval);
+	}
+
+	chip8_shared_close(shared);
+	return 0;
+}
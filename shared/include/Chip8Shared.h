@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Read side of the shared memory export, see SharedExport.h for the writer. The emulator keeps
+// a POSIX shared memory segment holding its latest frame: display, keys, registers and a frame
+// counter. Any number of readers map it and copy a frame out whenever they like, nothing they do
+// ever makes the emulator wait.
+//
+// The state is guarded by a seqlock. The writer makes sequence odd, updates the state and makes
+// it even again, so a reader that saw the same even sequence before and after its copy knows
+// the copy is whole. chip8_shared_read does all of that, the layout is here for anyone mapping
+// the segment themselves.
+//
+//   chip8_shared* shared = chip8_shared_open("/chip8");
+//   chip8_shared_state state;
+//   if (chip8_shared_read(shared, &state) == 0) ...
+
+#if defined(_WIN32)
+#define CHIP8_SHARED_API __declspec(dllexport)
+#else
+#define CHIP8_SHARED_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_SHARED_MAGIC 0x38504843u
+#define CHIP8_SHARED_VERSION 1
+
+// Set in flags once the writer has gone, the last frame it published stays readable
+#define CHIP8_SHARED_CLOSED 1
+
+typedef struct chip8_shared_state
+{
+	// Frames the machine has run since its rom was loaded
+	uint32_t frame;
+
+	// Both planes as 64 rows of two native endian words, leftmost pixel in the highest bit.
+	// Lo-res games only use the first word of the top 32 rows.
+	uint64_t graphics[2][64][2];
+
+	// Bit k holds key k down
+	uint16_t keys;
+	uint16_t program_counter;
+	uint16_t index_register;
+	uint16_t stack[16];
+	uint8_t registers[16];
+	uint8_t delay_timer;
+	uint8_t sound_timer;
+	uint8_t stack_pointer;
+	uint8_t high_resolution;
+
+	// CHIP8_PROFILE_ value from Chip8Api.h, and the fault flags raised so far
+	uint8_t profile;
+	uint8_t faults;
+} chip8_shared_state;
+
+typedef struct chip8_shared_segment
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t flags;
+
+	// Odd while the state is being written, advances by two for every frame published
+	uint64_t sequence;
+
+	chip8_shared_state state;
+} chip8_shared_segment;
+
+typedef struct chip8_shared chip8_shared;
+
+// Maps the segment the emulator was told to publish under name, returns NULL if there is no
+// such segment or it is from an incompatible version
+CHIP8_SHARED_API chip8_shared* chip8_shared_open(const char* name);
+CHIP8_SHARED_API void chip8_shared_close(chip8_shared* shared);
+
+// Frames published so far, cheap enough to poll for a new one before copying it
+CHIP8_SHARED_API uint64_t chip8_shared_published(const chip8_shared* shared);
+
+// Copies out the latest frame. Returns 0, or -1 if the writer kept overwriting it, which only
+// happens when the reader is starved of time.
+CHIP8_SHARED_API int chip8_shared_read(const chip8_shared* shared, chip8_shared_state* out);
+
+// 1 once the emulator has stopped publishing
+CHIP8_SHARED_API int chip8_shared_closed(const chip8_shared* shared);
+
+#ifdef __cplusplus
+}
+#endif
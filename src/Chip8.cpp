@@ -1,15 +1,25 @@
-#include "Opcode.h"
+#include <random>
+
+#include "Interpreter.h"
 #include "Chip8.h"
+#include "Fusion.h"
 #include "Font.h"
 
 Chip8::Chip8()
+	: QuirkProfile(Profile::Modern), Target(Variant::Chip8)
 {
+	memset(Flags, 0, sizeof(Flags));
+	SeedRandom(std::random_device()());
 	ResetCpu();
 }
 
 void Chip8::LoadRom(byte* code, int len)
 {
 	ResetCpu();
+
+	if (len > MEMORY_SIZE - PROGRAM_START)
+		len = MEMORY_SIZE - PROGRAM_START;
+
 	memcpy(Memory + PROGRAM_START, code, len);
 }
 
@@ -18,23 +28,291 @@ void Chip8::UnloadRom()
 	ResetCpu();
 }
 
-void Chip8::ClockCycle()
+void Chip8::SetProfile(Profile profile)
+{
+	QuirkProfile = profile;
+	Target = ProfileVariant(profile);
+}
+
+void Chip8::SeedRandom(uint32_t seed)
+{
+	// Xorshift never leaves zero, so that one seed is swapped for another
+	RandomState = seed ? seed : 0x2545F491;
+}
+
+const char* FaultName(int kind)
+{
+	switch (kind)
+	{
+	case 0: return "stack overflow";
+	case 1: return "stack underflow";
+	case 2: return "index out of range";
+	case 3: return "unknown opcode";
+	default: return "";
+	}
+}
+
+bool Chip8::IsBlocked() const
+{
+	// Running timers still count down and stop the beep, so only a machine with both at zero can rest
+	if (DelayTimer || SoundTimer)
+		return false;
+
+	word code = Memory[ProgramCounter] << 8 | Memory[(ProgramCounter + 1) & MEMORY_MASK];
+
+	if ((code & 0xF0FF) == 0xF00A)
+	{
+		for (int k = 0; k < 16; k++)
+		{
+			if (Keyboard[k])
+				return false;
+		}
+		return true;
+	}
+
+	// A jump to itself is the usual way to halt, 00FD is the SUPER-CHIP one
+	if ((code & 0xF000) == 0x1000 && (code & 0x0FFF) == ProgramCounter)
+		return true;
+
+	return code == 0x00FD && Target != Variant::Chip8;
+}
+
+bool Chip8::ClockCycle()
+{
+	return VisitProfile(QuirkProfile, [&](auto quirks) { return Interpreter<decltype(quirks)>::Step(*this); });
+}
+
+int Chip8::RunFrame(int cycles)
+{
+	return VisitProfile(QuirkProfile, [&](auto quirks) { return FusedInterpreter<decltype(quirks)>::RunFrame(*this, FusionCache::Local(), cycles); });
+}
+
+void Chip8::TickTimers()
 {
-	word instruction = Memory[ProgramCounter] << 8 | Memory[ProgramCounter + 1];
-	Opcode code = Opcodes::Match(instruction);
-	code.Execute(instruction, *this);
-	
 	if (DelayTimer > 0)
 		DelayTimer--;
 
 	if (SoundTimer > 0)
 		SoundTimer--;
+
+	Frame++;
+	if ((Frame % WRITE_HISTORY_FRAMES) == 0)
+		SweepWriteStamps();
+}
+
+void Chip8::SweepWriteStamps()
+{
+	// Run every WRITE_HISTORY_FRAMES so no live stamp gets old enough to alias in 7 bits. Most
+	// programs only write a handful of pages, the rest are skipped without being read.
+	for (int page = 0; page < STAMP_PAGES; page++)
+	{
+		uint64_t bit = 1ull << (page % 64);
+		uint64_t& pages = StampedPages[page / 64];
+		if (!(pages & bit))
+			continue;
+
+		bool live = false;
+		for (int address = page * STAMP_PAGE_SIZE; address < (page + 1) * STAMP_PAGE_SIZE; address++)
+		{
+			byte stamp = WriteStamps[address];
+			if (!stamp)
+				continue;
+
+			if (((Frame - stamp) & 0x7F) >= WRITE_HISTORY_FRAMES)
+				WriteStamps[address] = 0;
+			else
+				live = true;
+		}
+
+		if (!live)
+			pages &= ~bit;
+	}
+}
+
+byte Chip8::GetPixel(int x, int y) const
+{
+	byte planes = 0;
+
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		if ((Graphics[plane][y][x >> 6] >> (63 - (x & 63))) & 1)
+			planes |= 1 << plane;
+	}
+
+	return planes;
+}
+
+void Chip8::SetPixel(int x, int y, byte planes)
+{
+	uint64_t bit = 1ull << (63 - (x & 63));
+
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		if (planes & (1 << plane))
+			Graphics[plane][y][x >> 6] |= bit;
+		else
+			Graphics[plane][y][x >> 6] &= ~bit;
+	}
+}
+
+void Chip8::ClearDisplay()
+{
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		if (PlaneMask & (1 << plane))
+			memset(Graphics[plane], 0, sizeof(Graphics[plane]));
+	}
+}
+
+template <bool Wrap>
+bool Chip8::DrawSprite(int x, int y, int width, int height)
+{
+	int displayHeight = DisplayHeight();
+	x &= DisplayWidth() - 1;
+	y &= displayHeight - 1;
+
+	int rowBytes = width / 8;
+	word address = IndexRegister;
+	uint64_t collision = 0;
+
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		if (!(PlaneMask & (1 << plane)))
+			continue;
+
+		for (int row = 0; row < height; row++)
+		{
+			int lineIndex = y + row;
+			if (lineIndex >= displayHeight)
+			{
+				if constexpr (!Wrap)
+					break;
+				lineIndex -= displayHeight;
+			}
+
+			word rowAddress = address + row * rowBytes;
+			uint64_t bits = Memory[rowAddress & MEMORY_MASK];
+			if (rowBytes == 2)
+				bits = bits << 8 | Memory[(rowAddress + 1) & MEMORY_MASK];
+
+			uint64_t span = bits << (64 - width);
+			uint64_t left = 0, right = 0;
+
+			if (HighResolution)
+			{
+				left = x < 64 ? span >> x : 0;
+				right = x < 64 ? (x ? span << (64 - x) : 0) : span >> (x - 64);
+
+				if constexpr (Wrap)
+					left |= x > 64 ? span << (128 - x) : 0;
+			}
+			else
+			{
+				// Lo-res only ever lives in the left word, whatever spills past it is clipped
+				left = span >> x;
+
+				if constexpr (Wrap)
+					left |= x ? span << (64 - x) : 0;
+			}
+
+			uint64_t* line = Graphics[plane][lineIndex];
+			collision |= (line[0] & left) | (line[1] & right);
+			line[0] ^= left;
+			line[1] ^= right;
+		}
+
+		address += height * rowBytes;
+	}
+
+	return collision != 0;
+}
+
+template bool Chip8::DrawSprite<false>(int x, int y, int width, int height);
+template bool Chip8::DrawSprite<true>(int x, int y, int width, int height);
+
+void Chip8::ScrollDown(int rows)
+{
+	int height = DisplayHeight();
+	if (rows > height)
+		rows = height;
+
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		if (!(PlaneMask & (1 << plane)))
+			continue;
+
+		memmove(Graphics[plane][rows], Graphics[plane][0], (height - rows) * sizeof(Graphics[plane][0]));
+		memset(Graphics[plane][0], 0, rows * sizeof(Graphics[plane][0]));
+	}
+}
+
+void Chip8::ScrollUp(int rows)
+{
+	int height = DisplayHeight();
+	if (rows > height)
+		rows = height;
+
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		if (!(PlaneMask & (1 << plane)))
+			continue;
+
+		memmove(Graphics[plane][0], Graphics[plane][rows], (height - rows) * sizeof(Graphics[plane][0]));
+		memset(Graphics[plane][height - rows], 0, rows * sizeof(Graphics[plane][0]));
+	}
+}
+
+void Chip8::ScrollLeft(int columns)
+{
+	if (columns <= 0 || columns >= 64)
+		return;
+
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		if (!(PlaneMask & (1 << plane)))
+			continue;
+
+		for (int y = 0; y < DisplayHeight(); y++)
+		{
+			uint64_t* line = Graphics[plane][y];
+			line[0] = line[0] << columns | line[1] >> (64 - columns);
+			line[1] <<= columns;
+		}
+	}
+}
+
+void Chip8::ScrollRight(int columns)
+{
+	if (columns <= 0 || columns >= 64)
+		return;
+
+	uint64_t rightMask = HighResolution ? ~0ull : 0;
+
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		if (!(PlaneMask & (1 << plane)))
+			continue;
+
+		for (int y = 0; y < DisplayHeight(); y++)
+		{
+			uint64_t* line = Graphics[plane][y];
+			line[1] = (line[1] >> columns | line[0] << (64 - columns)) & rightMask;
+			line[0] >>= columns;
+		}
+	}
+}
+
+void Chip8::SetResolution(bool high)
+{
+	HighResolution = high;
+	memset(Graphics, 0, sizeof(Graphics));
 }
 
 void Chip8::ResetCpu()
 {
 	memset(Memory, 0, ARRAYLEN(Memory));
 	memcpy(Memory + FONT_START, fontset, FONT_SIZE);
+	memcpy(Memory + BIG_FONT_START, bigfontset, BIG_FONT_SIZE);
 
 	memset(Registers, 0, ARRAYLEN(Registers));
 	IndexRegister = 0;
@@ -42,12 +320,27 @@ void Chip8::ResetCpu()
 	ProgramCounter = PROGRAM_START;
 
 	StackPointer = 0;
-	memset(Stack, 0, ARRAYLEN(Stack));
+	memset(Stack, 0, sizeof(Stack));
 
 	DelayTimer = 0;
 	SoundTimer = 0;
 
-	memset(Graphics, 0, ARRAYLEN(Graphics));
+	memset(Graphics, 0, sizeof(Graphics));
+	HighResolution = false;
+	PlaneMask = 1;
+
 	memset(Keyboard, 0, ARRAYLEN(Keyboard));
 
-}
\ No newline at end of file
+	memset(AudioPattern, 0, ARRAYLEN(AudioPattern));
+	Pitch = 64;
+
+	DirtyStart = 0;
+	DirtyEnd = MEMORY_SIZE;
+
+	memset(WriteStamps, 0, sizeof(WriteStamps));
+	memset(StampedPages, 0, sizeof(StampedPages));
+	Frame = 0;
+
+	Faults = 0;
+	FaultAddress = 0;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+
+#include "Disassembly.h"
+
+Disassembly::Disassembly()
+	: target(Variant::Chip8)
+{ }
+
+void Disassembly::Update(Chip8& cpu)
+{
+	if (lines.empty() || target != cpu.Target)
+	{
+		Rebuild(cpu);
+	}
+	else if (cpu.DirtyStart < cpu.DirtyEnd)
+	{
+		// An instruction can start up to three bytes before a written byte (F000 nnnn)
+		int start = (int)cpu.DirtyStart - 3;
+		int end = (int)cpu.DirtyEnd < Size() ? (int)cpu.DirtyEnd : Size();
+
+		for (int address = start < 0 ? 0 : start; address < end; address++)
+			Decode(cpu, address, lines[address]);
+	}
+
+	cpu.DirtyStart = MEMORY_SIZE;
+	cpu.DirtyEnd = 0;
+}
+
+void Disassembly::Invalidate()
+{
+	lines.clear();
+}
+
+void Disassembly::Rebuild(const Chip8& cpu)
+{
+	target = cpu.Target;
+
+	// Only XO-CHIP can reach past the first 4 KB
+	lines.resize(target == Variant::XoChip ? MEMORY_SIZE : 4096);
+
+	for (int address = 0; address < Size(); address++)
+		Decode(cpu, address, lines[address]);
+}
+
+void Disassembly::Decode(const Chip8& cpu, word address, DisassembledLine& line)
+{
+	word code = cpu.Memory[address] << 8 | cpu.Memory[(address + 1) & MEMORY_MASK];
+
+	line.Instruction = code;
+	line.Code = &Opcodes::Match(code, cpu.Target);
+	line.Target = -1;
+
+	switch (code >> 12)
+	{
+	case 0x1:
+	case 0x2:
+	case 0xB:
+		if (line.Code != &Opcodes::Nop)
+			line.Target = code & 0x0FFF;
+		break;
+	}
+
+	char* out = line.Text;
+	char* end = line.Text + sizeof(line.Text) - 1;
+
+	for (const char* format = line.Code->Format; *format && out < end;)
+	{
+		if (*format != '{')
+		{
+			*out++ = *format++;
+			continue;
+		}
+
+		const char* close = format;
+		while (*close && *close != '}')
+			close++;
+
+		int length = (int)(close - format - 1);
+		const char* token = format + 1;
+		char value[8] = "";
+
+		if (length == 1 && *token == 'x')
+			snprintf(value, sizeof(value), "%X", (code & 0x0F00) >> 8);
+		else if (length == 1 && *token == 'y')
+			snprintf(value, sizeof(value), "%X", (code & 0x00F0) >> 4);
+		else if (length == 1 && *token == 'n')
+			snprintf(value, sizeof(value), "%d", code & 0x000F);
+		else if (length == 2)
+			snprintf(value, sizeof(value), "#%02X", code & 0x00FF);
+		else if (length == 3)
+			snprintf(value, sizeof(value), "#%03X", code & 0x0FFF);
+		else if (length == 4 && *token == 'n')
+			snprintf(value, sizeof(value), "#%04X", cpu.Memory[(address + 2) & MEMORY_MASK] << 8 | cpu.Memory[(address + 3) & MEMORY_MASK]);
+		else
+			snprintf(value, sizeof(value), "#%04X", code);
+
+		for (const char* c = value; *c && out < end; c++)
+			*out++ = *c;
+
+		format = *close ? close + 1 : close;
+	}
+
+	*out = '\0';
+}
@@ -0,0 +1,97 @@
+#include <algorithm>
+
+#include "Fusion.h"
+
+const char* FusionName(Fusion kind)
+{
+	switch (kind)
+	{
+	case Fusion::None: return "none";
+	case Fusion::IndexDraw: return "Annn Dxyn";
+	case Fusion::LoadRun: return "6xkk run";
+	case Fusion::TimerPoll: return "Fx07 3xkk 1nnn";
+	case Fusion::CountLoop: return "7xkk 3xkk";
+	case Fusion::IndexLoad: return "Fx1E Fx65";
+	default: return "";
+	}
+}
+
+FusionCache::FusionCache()
+	: entries(CACHED)
+{
+	// Whichever way round the host stores a word, the first bytes of memory land under the mask
+	for (int length = 0; length <= 4; length++)
+	{
+		byte bytes[8] = {};
+		memset(bytes, 0xFF, length * 2);
+		memcpy(&masks[length], bytes, sizeof(uint64_t));
+	}
+
+	Clear();
+	ResetCounts();
+}
+
+FusionCache& FusionCache::Local()
+{
+	thread_local FusionCache cache;
+	return cache;
+}
+
+void FusionCache::Clear()
+{
+	std::fill(entries.begin(), entries.end(), Entry{UNDECODED, 0, Fusion::None, Variant::Chip8, 1});
+}
+
+void FusionCache::ResetCounts()
+{
+	Dispatches = 0;
+	Instructions = 0;
+	Rewrites = 0;
+
+	for (uint64_t& count : FusedInstructions)
+		count = 0;
+}
+
+FusionCache::Entry FusionCache::Decode(const Chip8& cpu, word address)
+{
+	word codes[4];
+	for (int i = 0; i < 4; i++)
+		codes[i] = cpu.Memory[address + i * 2] << 8 | cpu.Memory[address + i * 2 + 1];
+
+	auto op = [&](int i) { return codes[i] >> 12; };
+	auto low = [&](int i) { return codes[i] & 0xFF; };
+	auto x = [&](int i) { return (codes[i] >> 8) & 0xF; };
+
+	Entry entry = {0, codes[0], Fusion::None, cpu.Target, 1};
+
+	// Outside plain CHIP-8, Dxy0 is the 16x16 sprite and has a handler of its own
+	if (op(0) == 0xA && op(1) == 0xD && (cpu.Target == Variant::Chip8 || (codes[1] & 0xF) != 0))
+	{
+		entry.Kind = Fusion::IndexDraw;
+		entry.Length = 2;
+	}
+	else if (op(0) == 0x6 && op(1) == 0x6)
+	{
+		entry.Kind = Fusion::LoadRun;
+		entry.Length = 2;
+		while (entry.Length < 4 && op(entry.Length) == 0x6)
+			entry.Length++;
+	}
+	else if (op(0) == 0xF && low(0) == 0x07 && op(1) == 0x3 && x(1) == x(0) && op(2) == 0x1)
+	{
+		entry.Kind = Fusion::TimerPoll;
+		entry.Length = 3;
+	}
+	else if (op(0) == 0x7 && op(1) == 0x3 && x(1) == x(0))
+	{
+		entry.Kind = Fusion::CountLoop;
+		entry.Length = 2;
+	}
+	else if (op(0) == 0xF && low(0) == 0x1E && op(1) == 0xF && low(1) == 0x65)
+	{
+		entry.Kind = Fusion::IndexLoad;
+		entry.Length = 2;
+	}
+
+	return entry;
+}
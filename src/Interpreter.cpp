@@ -0,0 +1,6 @@
+#include "Interpreter.h"
+
+template struct Interpreter<Quirks::CosmacVip>;
+template struct Interpreter<Quirks::Modern>;
+template struct Interpreter<Quirks::SuperChip>;
+template struct Interpreter<Quirks::XoChip>;
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <stdio.h>
+
+#include "Lockstep.h"
+#include "Fusion.h"
+#include "Interpreter.h"
+#include "Opcode.h"
+
+// The decode switch, one instruction a call. This is what every other engine is checked against.
+static int RunSteps(Chip8& cpu, int budget, bool& vblank)
+{
+	vblank = cpu.ClockCycle();
+	return 1;
+}
+
+// The decode switch over as much of the budget as the frame allows, the shape a block cache or
+// JIT would take
+static int RunBlock(Chip8& cpu, int budget, bool& vblank)
+{
+	return VisitProfile(cpu.QuirkProfile, [&](auto quirks)
+		{
+			int run = 0;
+			vblank = false;
+			while (run < budget && !vblank)
+			{
+				vblank = Interpreter<decltype(quirks)>::Step(cpu);
+				run++;
+			}
+			return run;
+		});
+}
+
+// Predecoded, with the common instruction sequences run as superinstructions, see Fusion.h
+static int RunFused(Chip8& cpu, int budget, bool& vblank)
+{
+	return VisitProfile(cpu.QuirkProfile, [&](auto quirks) { return FusedInterpreter<decltype(quirks)>::Execute(cpu, FusionCache::Local(), budget, vblank); });
+}
+
+const Engine ENGINES[] =
+{
+	{"step", RunSteps},
+	{"block", RunBlock},
+	{"fused", RunFused}
+};
+
+const int ENGINE_COUNT = ARRAYLEN(ENGINES);
+
+const Engine* FindEngine(const std::string& name)
+{
+	for (const Engine& engine : ENGINES)
+	{
+		if (name == engine.Name)
+			return &engine;
+	}
+
+	return nullptr;
+}
+
+static void ClearDirty(Chip8& cpu)
+{
+	cpu.DirtyStart = MEMORY_SIZE;
+	cpu.DirtyEnd = 0;
+}
+
+static void AddDifference(std::string* diff, const char* name, int reference, int candidate)
+{
+	char line[96];
+	snprintf(line, sizeof(line), "  %-12s reference %04X  candidate %04X\n", name, reference, candidate);
+	*diff += line;
+}
+
+// Compares the two machines and, if diff is given, lists what differs. The cheap check only looks
+// at the memory either machine marked written since the last one.
+static bool Same(const Chip8& reference, const Chip8& candidate, bool wholeMachine, std::string* diff)
+{
+	bool same = true;
+
+	// Field names are printf formats taking an index, only formatted for a difference
+	auto check = [&](const char* field, int index, int a, int b)
+	{
+		if (a == b)
+			return;
+
+		same = false;
+		if (diff)
+		{
+			char name[16];
+			snprintf(name, sizeof(name), field, index);
+			AddDifference(diff, name, a, b);
+		}
+	};
+
+	for (int i = 0; i < 16; i++)
+		check("V%X", i, reference.Registers[i], candidate.Registers[i]);
+
+	check("I", 0, reference.IndexRegister, candidate.IndexRegister);
+	check("PC", 0, reference.ProgramCounter, candidate.ProgramCounter);
+	check("SP", 0, reference.StackPointer, candidate.StackPointer);
+
+	for (int i = 0; i < 16; i++)
+		check("Stack[%d]", i, reference.Stack[i], candidate.Stack[i]);
+
+	check("DT", 0, reference.DelayTimer, candidate.DelayTimer);
+	check("ST", 0, reference.SoundTimer, candidate.SoundTimer);
+	check("HighRes", 0, reference.HighResolution, candidate.HighResolution);
+	check("PlaneMask", 0, reference.PlaneMask, candidate.PlaneMask);
+	check("Random", 0, (int)reference.RandomState, (int)candidate.RandomState);
+	check("Faults", 0, reference.Faults, candidate.Faults);
+	check("FaultAddress", 0, reference.FaultAddress, candidate.FaultAddress);
+
+	for (int i = 0; i < 16; i++)
+		check("Flags[%d]", i, reference.Flags[i], candidate.Flags[i]);
+
+	uint32_t start = 0, end = MEMORY_SIZE;
+	if (!wholeMachine)
+	{
+		start = std::min(reference.DirtyStart, candidate.DirtyStart);
+		end = std::max(std::min<uint32_t>(reference.DirtyEnd, MEMORY_SIZE), std::min<uint32_t>(candidate.DirtyEnd, MEMORY_SIZE));
+	}
+
+	if (start < end && memcmp(reference.Memory + start, candidate.Memory + start, end - start) != 0)
+	{
+		same = false;
+
+		int listed = 0;
+		for (uint32_t address = start; diff && address < end && listed < 8; address++)
+		{
+			if (reference.Memory[address] != candidate.Memory[address])
+			{
+				check("[%04X]", address, reference.Memory[address], candidate.Memory[address]);
+				listed++;
+			}
+		}
+	}
+
+	if (wholeMachine)
+	{
+		if (memcmp(reference.Graphics, candidate.Graphics, sizeof(reference.Graphics)) != 0)
+		{
+			same = false;
+			if (diff)
+				*diff += "  framebuffer differs\n";
+		}
+
+		for (int i = 0; i < 16; i++)
+			check("Audio[%d]", i, reference.AudioPattern[i], candidate.AudioPattern[i]);
+
+		check("Pitch", 0, reference.Pitch, candidate.Pitch);
+	}
+
+	return same;
+}
+
+Lockstep::Lockstep(const Engine& reference, const Engine& candidate)
+	: BlockSize(1), referenceEngine(&reference), candidateEngine(&candidate),
+	reference(std::make_unique<Chip8>()), candidate(std::make_unique<Chip8>()),
+	referenceFrame(std::make_unique<Chip8>()), instructions(0), frameInstructions(0)
+{
+}
+
+void Lockstep::LoadRom(byte* code, int len, Profile profile, uint32_t seed)
+{
+	reference->SetProfile(profile);
+	reference->LoadRom(code, len);
+	reference->SeedRandom(seed);
+	ClearDirty(*reference);
+
+	*candidate = *reference;
+	instructions = 0;
+	divergence.clear();
+}
+
+void Lockstep::SetKeys(word mask)
+{
+	for (int k = 0; k < 16; k++)
+	{
+		reference->Keyboard[k] = (mask >> k) & 1;
+		candidate->Keyboard[k] = reference->Keyboard[k];
+	}
+}
+
+bool Lockstep::Matches(bool wholeMachine)
+{
+	bool same = Same(*reference, *candidate, wholeMachine, nullptr);
+
+	ClearDirty(*reference);
+	ClearDirty(*candidate);
+	return same;
+}
+
+bool Lockstep::RunFrame(int cycles)
+{
+	if (!divergence.empty())
+		return false;
+
+	*referenceFrame = *reference;
+	frameInstructions = instructions;
+
+	int cycle = 0;
+	bool vblank = false;
+
+	while (cycle < cycles && !vblank)
+	{
+		bool candidateVblank = false;
+		int run = candidateEngine->Run(*candidate, std::min(BlockSize, cycles - cycle), candidateVblank);
+
+		// The reference catches up one instruction at a time and has to land in the same place
+		bool referenceVblank = false;
+		int caughtUp = 0;
+		while (caughtUp < run && !referenceVblank)
+		{
+			referenceEngine->Run(*reference, 1, referenceVblank);
+			caughtUp++;
+		}
+
+		if (caughtUp != run || referenceVblank != candidateVblank || !Matches(false))
+		{
+			Explain(cycle, run, false);
+			return false;
+		}
+
+		cycle += run;
+		instructions += run;
+		vblank = candidateVblank;
+	}
+
+	reference->TickTimers();
+	candidate->TickTimers();
+
+	if (!Matches(true))
+	{
+		Explain(0, cycle, true);
+		return false;
+	}
+
+	return true;
+}
+
+// Replays the frame up to the block that went wrong on the reference alone, which matched the
+// candidate up to there, then single steps both engines through the block comparing everything
+// after each instruction
+void Lockstep::Explain(int blockStart, int blockLength, bool frameEnd)
+{
+	std::unique_ptr<Chip8> diverged = std::make_unique<Chip8>(*candidate);
+
+	bool vblank = false;
+	*reference = *referenceFrame;
+	for (int i = 0; i < blockStart; i++)
+		referenceEngine->Run(*reference, 1, vblank);
+
+	std::unique_ptr<Chip8> block = std::make_unique<Chip8>(*reference);
+	*candidate = *reference;
+
+	char line[160];
+	for (int i = 0; i < blockLength; i++)
+	{
+		word address = reference->ProgramCounter;
+		word code = reference->Memory[address] << 8 | reference->Memory[(address + 1) & MEMORY_MASK];
+
+		bool referenceVblank = false, candidateVblank = false;
+		referenceEngine->Run(*reference, 1, referenceVblank);
+		candidateEngine->Run(*candidate, 1, candidateVblank);
+
+		std::string diff;
+		if (referenceVblank != candidateVblank)
+			diff += "  only one engine waited for vblank\n";
+
+		if (!Same(*reference, *candidate, true, &diff) || !diff.empty())
+		{
+			snprintf(line, sizeof(line), "diverged on instruction %llu of frame %u, at %04X: %04X %s\n",
+				(unsigned long long)(frameInstructions + blockStart + i), reference->Frame, address, code,
+				Opcodes::Match(code, reference->Target).Description);
+			divergence = line + diff;
+			return;
+		}
+	}
+
+	// Single steps agree, so the fault is in how the candidate runs a whole block or ends the
+	// frame rather than in any one instruction
+	*reference = *block;
+	vblank = false;
+	for (int i = 0; i < blockLength && !vblank; i++)
+		referenceEngine->Run(*reference, 1, vblank);
+	if (frameEnd)
+		reference->TickTimers();
+
+	*candidate = *diverged;
+
+	std::string diff;
+	Same(*reference, *candidate, true, &diff);
+
+	snprintf(line, sizeof(line), "diverged in the %d instruction %s starting at %04X, instruction %llu of frame %u\n",
+		blockLength, frameEnd ? "frame" : "block", block->ProgramCounter, (unsigned long long)(frameInstructions + blockStart), block->Frame);
+	divergence = line + diff;
+}
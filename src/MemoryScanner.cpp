@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <bitset>
+
+#include "MemoryScanner.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCANNER_SSE2
+#include <emmintrin.h>
+#endif
+
+// Everything but the registers, which take the low 16 bits of the last bitmap word
+const int MEMORY_WORDS = MEMORY_SIZE / 64;
+const int BITMAP_WORDS = MEMORY_WORDS + 1;
+
+const char* ScanPredicateName(ScanPredicate predicate)
+{
+	switch (predicate)
+	{
+	case ScanPredicate::Unchanged: return "Unchanged";
+	case ScanPredicate::Changed: return "Changed";
+	case ScanPredicate::Increased: return "Increased";
+	case ScanPredicate::Decreased: return "Decreased";
+	case ScanPredicate::EqualTo: return "Equal To";
+	default: return "";
+	}
+}
+
+// Bit i set if byte i of now matches the predicate against byte i of before
+static uint32_t Match16(const byte* now, const byte* before, ScanPredicate predicate, byte value)
+{
+#ifdef SCANNER_SSE2
+	__m128i a = _mm_loadu_si128((const __m128i*)now);
+	__m128i b = _mm_loadu_si128((const __m128i*)before);
+
+	// SSE2 only compares signed bytes, flipping the top bit makes that an unsigned compare
+	const __m128i bias = _mm_set1_epi8((char)0x80);
+
+	switch (predicate)
+	{
+	case ScanPredicate::Unchanged:
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+	case ScanPredicate::Changed:
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) ^ 0xFFFF;
+	case ScanPredicate::Increased:
+		return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)));
+	case ScanPredicate::Decreased:
+		return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_xor_si128(b, bias), _mm_xor_si128(a, bias)));
+	case ScanPredicate::EqualTo:
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_set1_epi8((char)value)));
+	default:
+		return 0;
+	}
+#else
+	uint32_t mask = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		bool match = false;
+		switch (predicate)
+		{
+		case ScanPredicate::Unchanged: match = now[i] == before[i]; break;
+		case ScanPredicate::Changed: match = now[i] != before[i]; break;
+		case ScanPredicate::Increased: match = now[i] > before[i]; break;
+		case ScanPredicate::Decreased: match = now[i] < before[i]; break;
+		case ScanPredicate::EqualTo: match = now[i] == value; break;
+		default: break;
+		}
+		mask |= (uint32_t)match << i;
+	}
+	return mask;
+#endif
+}
+
+MemoryScanner::MemoryScanner()
+	: previous(SCAN_SIZE), candidates(BITMAP_WORDS), count(0), scanning(false)
+{
+}
+
+void MemoryScanner::Snapshot(const Chip8& cpu)
+{
+	memcpy(previous.data(), cpu.Memory, MEMORY_SIZE);
+	memcpy(previous.data() + SCAN_REGISTERS, cpu.Registers, 16);
+}
+
+void MemoryScanner::Start(const Chip8& cpu)
+{
+	int reachable = cpu.Target == Variant::XoChip ? MEMORY_SIZE : 0x1000;
+
+	std::fill(candidates.begin(), candidates.end(), 0);
+	std::fill(candidates.begin(), candidates.begin() + reachable / 64, ~0ull);
+	candidates[MEMORY_WORDS] = 0xFFFF;
+
+	count = reachable + 16;
+	scanning = true;
+	Snapshot(cpu);
+}
+
+int MemoryScanner::Narrow(const Chip8& cpu, ScanPredicate predicate, byte value)
+{
+	if (!scanning)
+		Start(cpu);
+
+	// Whole words that already dropped out are skipped, so later scans only look at what is left
+	count = 0;
+	for (int w = 0; w < MEMORY_WORDS; w++)
+	{
+		if (candidates[w] == 0)
+			continue;
+
+		int base = w * 64;
+		uint64_t mask = 0;
+		for (int part = 0; part < 4; part++)
+			mask |= (uint64_t)Match16(cpu.Memory + base + part * 16, previous.data() + base + part * 16, predicate, value) << (part * 16);
+
+		candidates[w] &= mask;
+		count += (int)std::bitset<64>(candidates[w]).count();
+	}
+
+	candidates[MEMORY_WORDS] &= Match16(cpu.Registers, previous.data() + SCAN_REGISTERS, predicate, value);
+	count += (int)std::bitset<64>(candidates[MEMORY_WORDS]).count();
+
+	Snapshot(cpu);
+	return count;
+}
+
+int MemoryScanner::Candidates(int* out, int limit) const
+{
+	int found = 0;
+	for (int w = 0; w < BITMAP_WORDS && found < limit; w++)
+	{
+		uint64_t bits = candidates[w];
+		for (int bit = 0; bits != 0 && found < limit; bit++, bits >>= 1)
+		{
+			if (bits & 1)
+				out[found++] = w * 64 + bit;
+		}
+	}
+
+	return found;
+}
+
+byte MemoryScanner::Read(const Chip8& cpu, int address)
+{
+	if (address >= SCAN_REGISTERS)
+		return cpu.Registers[(address - SCAN_REGISTERS) & 0xF];
+
+	return cpu.Memory[address & MEMORY_MASK];
+}
+
+void MemoryScanner::Write(Chip8& cpu, int address, byte value)
+{
+	if (Read(cpu, address) == value)
+		return;
+
+	if (address >= SCAN_REGISTERS)
+	{
+		cpu.Registers[(address - SCAN_REGISTERS) & 0xF] = value;
+	}
+	else
+	{
+		cpu.Memory[address & MEMORY_MASK] = value;
+		cpu.MarkDirty(address, 1);
+	}
+}
+
+void MemoryScanner::AddFreeze(int address, byte value)
+{
+	for (Freeze& freeze : freezes)
+	{
+		if (freeze.Address == address)
+		{
+			freeze.Value = value;
+			return;
+		}
+	}
+
+	freezes.push_back({address, value});
+}
+
+void MemoryScanner::RemoveFreeze(int address)
+{
+	freezes.erase(std::remove_if(freezes.begin(), freezes.end(), [&](const Freeze& freeze) { return freeze.Address == address; }), freezes.end());
+}
+
+void MemoryScanner::ApplyFreezes(Chip8& cpu) const
+{
+	for (const Freeze& freeze : freezes)
+		Write(cpu, freeze.Address, freeze.Value);
+}
+
+void MemoryScanner::AddWatch(const Chip8& cpu, int address)
+{
+	for (const Watch& watch : watches)
+	{
+		if (watch.Address == address)
+			return;
+	}
+
+	watches.push_back({address, Read(cpu, address)});
+}
+
+void MemoryScanner::RemoveWatch(int address)
+{
+	watches.erase(std::remove_if(watches.begin(), watches.end(), [&](const Watch& watch) { return watch.Address == address; }), watches.end());
+}
+
+bool MemoryScanner::CheckWatches(const Chip8& cpu)
+{
+	bool hit = false;
+	for (Watch& watch : watches)
+	{
+		byte now = Read(cpu, watch.Address);
+		if (now != watch.Seen)
+		{
+			watch.Seen = now;
+			hit = true;
+		}
+	}
+
+	return hit;
+}
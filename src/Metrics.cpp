@@ -0,0 +1,402 @@
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Metrics.h"
+#include "Fusion.h"
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+namespace Metrics
+{
+	struct CounterInfo
+	{
+		const char* Name;
+		const char* Help;
+	};
+
+	static const CounterInfo COUNTERS[COUNTER_COUNT] =
+	{
+		{"chip8_instructions_total", "Instructions executed."},
+		{"chip8_frames_total", "Frames run, idle ones included."},
+		{"chip8_idle_frames_total", "Frames skipped because the machine was blocked."},
+		{"chip8_idle_cycles_total", "Instructions not run because their frame was skipped."},
+		{"chip8_snapshots_total", "Save states taken."},
+		{"chip8_restores_total", "Save states loaded back."},
+		{"chip8_fusion_dispatches_total", "Dispatches through the superinstruction cache."},
+		{"chip8_fusion_hits_total", "Instructions run inside a superinstruction."},
+		{"chip8_fusion_rewrites_total", "Superinstruction cache entries decoded again after the code changed."}
+	};
+
+	static const char* OPCODE_GROUP_NAMES[OPCODE_GROUPS] =
+	{
+		"0nnn", "1nnn", "2nnn", "3xkk", "4xkk", "5xyn", "6xkk", "7xkk",
+		"8xyn", "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn", "Exkk", "Fxkk"
+	};
+
+	// Shards are only ever added, a scrape holds the lock while it reads them
+	static std::mutex registryLock;
+	static std::vector<std::unique_ptr<Shard>> shards;
+
+	static const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+	// The rate is taken between one scrape and the next, whoever asked for them
+	static std::chrono::steady_clock::time_point lastScrape = started;
+	static uint64_t lastInstructions = 0;
+	static double instructionsPerSecond = 0;
+
+	static std::atomic<bool> stopping(false);
+	static std::thread server;
+	static std::thread writer;
+	static std::mutex writerLock;
+	static std::condition_variable writerWake;
+	static int listener = -1;
+	static std::string socketPath;
+
+	Shard::Shard()
+	{
+		for (std::atomic<uint64_t>& counter : counters)
+			counter.store(0, std::memory_order_relaxed);
+
+		for (std::atomic<uint64_t>& group : opcodes)
+			group.store(0, std::memory_order_relaxed);
+	}
+
+	Shard& Local()
+	{
+		thread_local Shard* local = nullptr;
+		if (!local)
+		{
+			std::lock_guard<std::mutex> lock(registryLock);
+			shards.push_back(std::make_unique<Shard>());
+			local = shards.back().get();
+		}
+
+		return *local;
+	}
+
+	// Fills the histogram of the frame being run, the fused interpreter fetches through it
+	struct OpcodeCounter : NullObserver
+	{
+		static thread_local uint64_t Groups[OPCODE_GROUPS];
+
+		static void OnFetch(const Chip8& cpu, word address, word code) { Groups[code >> 12]++; }
+	};
+
+	thread_local uint64_t OpcodeCounter::Groups[OPCODE_GROUPS];
+
+	int RunFrame(Chip8& cpu, int cycles, Shard& shard)
+	{
+		shard.Add(FRAMES, 1);
+
+		if (cpu.IsBlocked())
+		{
+			cpu.TickTimers();
+			shard.Add(IDLE_FRAMES, 1);
+			shard.Add(IDLE_CYCLES, cycles);
+			return cycles;
+		}
+
+		FusionCache& cache = FusionCache::Local();
+		uint64_t dispatches = cache.Dispatches;
+		uint64_t singles = cache.FusedInstructions[(int)Fusion::None];
+		uint64_t rewrites = cache.Rewrites;
+
+		int cycle = VisitProfile(cpu.QuirkProfile, [&](auto quirks) { return FusedInterpreter<decltype(quirks), OpcodeCounter>::RunFrame(cpu, cache, cycles); });
+
+		shard.Add(INSTRUCTIONS, cycle);
+		shard.AddOpcodes(OpcodeCounter::Groups);
+		memset(OpcodeCounter::Groups, 0, sizeof(OpcodeCounter::Groups));
+
+		shard.Add(FUSION_DISPATCHES, cache.Dispatches - dispatches);
+		shard.Add(FUSION_HITS, cycle - (cache.FusedInstructions[(int)Fusion::None] - singles));
+		shard.Add(FUSION_REWRITES, cache.Rewrites - rewrites);
+
+		return cycle;
+	}
+
+	std::string Scrape()
+	{
+		uint64_t totals[COUNTER_COUNT] = {};
+		uint64_t groups[OPCODE_GROUPS] = {};
+		size_t threads;
+
+		std::lock_guard<std::mutex> lock(registryLock);
+
+		for (const std::unique_ptr<Shard>& shard : shards)
+		{
+			for (int counter = 0; counter < COUNTER_COUNT; counter++)
+				totals[counter] += shard->Get((Counter)counter);
+
+			for (int group = 0; group < OPCODE_GROUPS; group++)
+				groups[group] += shard->Opcodes(group);
+		}
+		threads = shards.size();
+
+		auto now = std::chrono::steady_clock::now();
+		double elapsed = std::chrono::duration<double>(now - lastScrape).count();
+		if (elapsed >= 0.25)
+		{
+			instructionsPerSecond = (totals[INSTRUCTIONS] - lastInstructions) / elapsed;
+			lastInstructions = totals[INSTRUCTIONS];
+			lastScrape = now;
+		}
+
+		std::string text;
+		char line[256];
+
+		for (int counter = 0; counter < COUNTER_COUNT; counter++)
+		{
+			snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+				COUNTERS[counter].Name, COUNTERS[counter].Help, COUNTERS[counter].Name, COUNTERS[counter].Name, (unsigned long long)totals[counter]);
+			text += line;
+		}
+
+		text += "# HELP chip8_opcodes_total Instructions executed by leading nibble.\n# TYPE chip8_opcodes_total counter\n";
+		for (int group = 0; group < OPCODE_GROUPS; group++)
+		{
+			snprintf(line, sizeof(line), "chip8_opcodes_total{group=\"%s\"} %llu\n", OPCODE_GROUP_NAMES[group], (unsigned long long)groups[group]);
+			text += line;
+		}
+
+		snprintf(line, sizeof(line), "# HELP chip8_instructions_per_second Instruction rate since the previous scrape.\n"
+			"# TYPE chip8_instructions_per_second gauge\nchip8_instructions_per_second %.0f\n", instructionsPerSecond);
+		text += line;
+
+		snprintf(line, sizeof(line), "# HELP chip8_threads Threads that have counted anything.\n# TYPE chip8_threads gauge\nchip8_threads %zu\n", threads);
+		text += line;
+
+		snprintf(line, sizeof(line), "# HELP chip8_uptime_seconds Seconds since the counters started.\n# TYPE chip8_uptime_seconds gauge\nchip8_uptime_seconds %.3f\n",
+			std::chrono::duration<double>(now - started).count());
+		text += line;
+
+		return text;
+	}
+
+	static void WriteScrape(const std::string& path, uint64_t maxBytes)
+	{
+		long long stamp = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+		{
+			std::ofstream file(path, std::ios::out | std::ios::app | std::ios::binary);
+			file << "# scraped at " << stamp << "\n" << Scrape();
+		}
+
+		std::error_code error;
+		if (std::filesystem::file_size(path, error) > maxBytes && !error)
+			std::filesystem::rename(path, path + ".1", error);
+	}
+
+	bool StartFile(const std::string& path, int intervalMs, uint64_t maxBytes)
+	{
+		if (writer.joinable() || intervalMs <= 0)
+			return false;
+
+		std::ofstream probe(path, std::ios::out | std::ios::app);
+		if (!probe)
+			return false;
+
+		stopping = false;
+		writer = std::thread([=]()
+			{
+				std::unique_lock<std::mutex> lock(writerLock);
+				while (!writerWake.wait_for(lock, std::chrono::milliseconds(intervalMs), [] { return stopping.load(); }))
+					WriteScrape(path, maxBytes);
+
+				WriteScrape(path, maxBytes);
+			});
+
+		return true;
+	}
+
+#ifdef _WIN32
+
+	// Like the remote control, this would need Winsock set up first
+	bool Serve(const std::string& endpoint) { return false; }
+	static void CloseListener() { }
+
+#else
+
+	static bool SendAll(int fd, const std::string& data)
+	{
+		size_t sent = 0;
+		while (sent < data.size())
+		{
+			ssize_t count = send(fd, data.data() + sent, data.size() - sent, SEND_FLAGS);
+			if (count <= 0)
+				return false;
+			sent += count;
+		}
+
+		return true;
+	}
+
+	// Reads the request head, whatever it asked for, and answers with a scrape. A client gets a
+	// second to send it so a stalled one can't hold up the next.
+	static void Answer(int client)
+	{
+		timeval timeout = {1, 0};
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		std::string request;
+		char buffer[1024];
+		while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+		{
+			ssize_t count = recv(client, buffer, sizeof(buffer), 0);
+			if (count <= 0)
+				break;
+			request.append(buffer, count);
+		}
+
+		std::string body = Scrape();
+		char head[160];
+		snprintf(head, sizeof(head), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", body.size());
+
+		if (SendAll(client, head))
+			SendAll(client, body);
+	}
+
+	static int ListenTcp(int port)
+	{
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+
+		int reuse = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons((uint16_t)port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 8) != 0)
+		{
+			close(fd);
+			return -1;
+		}
+
+		return fd;
+	}
+
+	static int ListenUnix(const std::string& path)
+	{
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+			return -1;
+		memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+
+		unlink(path.c_str());
+
+		if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 8) != 0)
+		{
+			close(fd);
+			return -1;
+		}
+
+		return fd;
+	}
+
+	bool Serve(const std::string& endpoint)
+	{
+		if (server.joinable())
+			return false;
+
+		bool isPath = endpoint.find('/') != std::string::npos;
+		if (isPath)
+		{
+			listener = ListenUnix(endpoint);
+			socketPath = endpoint;
+		}
+		else
+		{
+			int port = atoi(endpoint.c_str());
+			listener = port > 0 && port < 65536 ? ListenTcp(port) : -1;
+		}
+
+		if (listener < 0)
+			return false;
+
+		stopping = false;
+		server = std::thread([]()
+			{
+				while (!stopping)
+				{
+					pollfd fd = {};
+					fd.fd = listener;
+					fd.events = POLLIN;
+					if (poll(&fd, 1, 100) <= 0)
+						continue;
+
+					int client = accept(listener, nullptr, nullptr);
+					if (client < 0)
+						continue;
+
+					Answer(client);
+					close(client);
+				}
+			});
+
+		return true;
+	}
+
+	static void CloseListener()
+	{
+		if (listener >= 0)
+			close(listener);
+		listener = -1;
+
+		if (!socketPath.empty())
+			unlink(socketPath.c_str());
+		socketPath.clear();
+	}
+
+#endif
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(writerLock);
+			stopping = true;
+		}
+		writerWake.notify_all();
+
+		if (server.joinable())
+			server.join();
+		if (writer.joinable())
+			writer.join();
+
+		CloseListener();
+		stopping = false;
+	}
+
+	// The threads have to be joined before their statics go, for anyone who never called Stop
+	static struct StopAtExit
+	{
+		~StopAtExit() { Stop(); }
+	} stopAtExit;
+}
@@ -1,6 +1,65 @@
 #include "Opcode.h"
 
-const Opcode& Opcodes::Match(word code)
+// Only reached once the plain CHIP-8 decode has missed, so the extended sets cost nothing there
+static const Opcode& MatchExtended(word code, Variant target)
+{
+	switch ((code >> 12))
+	{
+	case 0x0:
+		if ((code & 0xFFF0) == 0x00C0)
+			return Opcodes::Op00Cn;
+
+		if ((code & 0xFFF0) == 0x00D0 && target == Variant::XoChip)
+			return Opcodes::Op00Dn;
+
+		switch (code & 0xFFF)
+		{
+		case 0x0FB: return Opcodes::Op00FB;
+		case 0x0FC: return Opcodes::Op00FC;
+		case 0x0FD: return Opcodes::Op00FD;
+		case 0x0FE: return Opcodes::Op00FE;
+		case 0x0FF: return Opcodes::Op00FF;
+		}
+		break;
+
+	case 0x5:
+		if (target != Variant::XoChip)
+			break;
+
+		switch (code & 0xF)
+		{
+		case 0x2: return Opcodes::Op5xy2;
+		case 0x3: return Opcodes::Op5xy3;
+		}
+		break;
+
+	case 0xF:
+		if (code == 0xF000 && target == Variant::XoChip)
+			return Opcodes::OpF000;
+
+		switch (code & 0xFF)
+		{
+		case 0x30: return Opcodes::OpFx30;
+		case 0x75: return Opcodes::OpFx75;
+		case 0x85: return Opcodes::OpFx85;
+		}
+
+		if (target != Variant::XoChip)
+			break;
+
+		switch (code & 0xFF)
+		{
+		case 0x01: return Opcodes::OpFn01;
+		case 0x02: return (code == 0xF002) ? Opcodes::OpF002 : Opcodes::Nop;
+		case 0x3A: return Opcodes::OpFx3A;
+		}
+		break;
+	}
+
+	return Opcodes::Nop;
+}
+
+const Opcode& Opcodes::Match(word code, Variant target)
 {
 	switch ((code >> 12))
 	{
@@ -16,7 +75,12 @@ const Opcode& Opcodes::Match(word code)
 	case 0x2: return Opcodes::Op2nnn;
 	case 0x3: return Opcodes::Op3xkk;
 	case 0x4: return Opcodes::Op4xkk;
-	case 0x5: return Opcodes::Op5xy0;
+
+	case 0x5:
+		if ((code & 0xF) == 0x0)
+			return Opcodes::Op5xy0;
+		break;
+
 	case 0x6: return Opcodes::Op6xkk;
 	case 0x7: return Opcodes::Op7xkk;
 
@@ -39,7 +103,11 @@ const Opcode& Opcodes::Match(word code)
 	case 0xA: return Opcodes::OpAnnn;
 	case 0xB: return Opcodes::OpBnnn;
 	case 0xC: return Opcodes::OpCxkk;
-	case 0xD: return Opcodes::OpDxyn;
+
+	case 0xD:
+		if ((code & 0xF) == 0x0 && target != Variant::Chip8)
+			return Opcodes::OpDxy0;
+		return Opcodes::OpDxyn;
 
 	case 0xE:
 		switch (code & 0xFF)
@@ -65,5 +133,8 @@ const Opcode& Opcodes::Match(word code)
 		break;
 	}
 
+	if (target != Variant::Chip8)
+		return MatchExtended(code, target);
+
 	return Opcodes::Nop;
 }
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace Profiler
+{
+	struct TraceEvent
+	{
+		int Zone;
+		int64_t Start;
+		int64_t End;
+	};
+
+	// A few minutes of a busy frame, past that a capture just stops growing
+	const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+	// Slot 0 is the whole frame, zone n lives in slot n + 1
+	const int SLOTS = MAX_ZONES + 1;
+
+	static const char* zoneNames[MAX_ZONES];
+	static int zoneCount = 0;
+
+	static int64_t current[SLOTS];
+	static float history[HISTORY_FRAMES][SLOTS];
+	static int historyHead = 0;
+	static int historyCount = 0;
+	static int64_t frameStart = 0;
+
+	static bool capturing = false;
+	static std::vector<TraceEvent> events;
+
+	int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	int RegisterZone(const char* name)
+	{
+		if (zoneCount == MAX_ZONES)
+			return -2;
+
+		zoneNames[zoneCount] = name;
+		return zoneCount++;
+	}
+
+	void Record(int zone, int64_t start, int64_t end)
+	{
+		if (zone < 0)
+			return;
+
+		current[zone + 1] += end - start;
+
+		if (capturing && events.size() < MAX_TRACE_EVENTS)
+			events.push_back({zone, start, end});
+	}
+
+	void EndFrame()
+	{
+		int64_t now = Now();
+		if (frameStart == 0)
+			frameStart = now;
+
+		current[0] = now - frameStart;
+
+		if (capturing && events.size() < MAX_TRACE_EVENTS)
+			events.push_back({FRAME, frameStart, now});
+
+		for (int slot = 0; slot < SLOTS; slot++)
+		{
+			history[historyHead][slot] = current[slot] / 1e6f;
+			current[slot] = 0;
+		}
+
+		historyHead = (historyHead + 1) % HISTORY_FRAMES;
+		historyCount = std::min(historyCount + 1, HISTORY_FRAMES);
+		frameStart = now;
+	}
+
+	int ZoneCount()
+	{
+		return zoneCount;
+	}
+
+	const char* ZoneName(int zone)
+	{
+		return zone == FRAME ? "Frame" : zoneNames[zone];
+	}
+
+	int History(int zone, float* out)
+	{
+		int first = (historyHead - historyCount + HISTORY_FRAMES) % HISTORY_FRAMES;
+		for (int i = 0; i < historyCount; i++)
+			out[i] = history[(first + i) % HISTORY_FRAMES][zone + 1];
+
+		return historyCount;
+	}
+
+	Percentiles Summarize(int zone)
+	{
+		float samples[HISTORY_FRAMES];
+		int count = History(zone, samples);
+		if (count == 0)
+			return {0, 0, 0};
+
+		std::sort(samples, samples + count);
+		return {samples[count / 2], samples[(count * 99) / 100], samples[count - 1]};
+	}
+
+	void StartCapture()
+	{
+		events.clear();
+		capturing = true;
+	}
+
+	bool IsCapturing()
+	{
+		return capturing;
+	}
+
+	bool StopCapture(const std::string& path)
+	{
+		capturing = false;
+
+		std::ofstream file(path, std::ios::out | std::ios::trunc);
+		if (!file)
+			return false;
+
+		int64_t origin = events.empty() ? 0 : events.front().Start;
+		for (const TraceEvent& event : events)
+			origin = std::min(origin, event.Start);
+
+		// Complete events in microseconds, everything on one thread since the loop is single threaded
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			const TraceEvent& event = events[i];
+			file << "{\"name\":\"" << ZoneName(event.Zone) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+				<< ",\"ts\":" << (event.Start - origin) / 1000.0
+				<< ",\"dur\":" << (event.End - event.Start) / 1000.0 << "}"
+				<< (i + 1 < events.size() ? ",\n" : "\n");
+		}
+		file << "]}\n";
+
+		events.clear();
+		events.shrink_to_fit();
+		return (bool)file;
+	}
+}
@@ -1,12 +1,15 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <cmath>
 #include <unordered_set>
 
 #include <imgui.h>
 #include <imgui-SFML.h>
 
 #include <SFML/Graphics/RenderWindow.hpp>
-#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/Texture.hpp>
 #include <SFML/Audio/SoundBuffer.hpp>
 #include <SFML/Audio/Sound.hpp>
 #include <SFML/System/Clock.hpp>
@@ -16,30 +19,55 @@
 #include "DebugState.h"
 #include "Chip8.h"
 #include "Opcode.h"
+#include "Disassembly.h"
+#include "Quirks.h"
+#include "RomCatalog.h"
+#include "Profiler.h"
+#include "Upscaler.h"
+#include "Recorder.h"
+#include "Remote.h"
+#include "MemoryScanner.h"
+#include "Instance.h"
+#include "WorkerPool.h"
+#include "SharedExport.h"
+#include "Snapshot.h"
 
 class Game
 {
 private:
 	sf::RenderWindow window;
 
-	sf::Color setColor;
-	sf::Color unsetColor;
-
 	bool beeping;
 	sf::Sound beep;
 	sf::SoundBuffer beepBuffer;
 
-	const char* currentRomPath = nullptr;
-	int currentRomLength;
+	RomCatalog catalog;
+	DebugState state;
 
-	std::unordered_set<int> breakpoints;
+	// Menus, debugger views, audio and the remote all work on the focused instance. The keyboard
+	// goes to it too, or to every instance while state.LinkInput is set.
+	std::vector<std::unique_ptr<Instance>> instances;
+	int focused = 0;
+	int nextInstanceId = 1;
+	bool arrangePanels = false;
 
-	DebugState state;
-	Chip8 cpu;
+	WorkerPool workers;
+	std::vector<int> listedCandidates;
+
+	RemoteServer remote;
+	SharedExport shared;
+
+	// Power saving, what was last drawn and how many more frames to draw after an input event
+	const sf::Time IDLE_TIMEOUT = sf::milliseconds(250);
+	const sf::Time IDLE_POLL_INTERVAL = sf::milliseconds(5);
+	const int IDLE_REDRAW_FRAMES = 3;
+
+	int redrawFrames = IDLE_REDRAW_FRAMES;
+	bool wasIdle = false;
 
 public:
 	Game()
-		: window(sf::VideoMode(640, 640), "Chip-8 Emulator"), state(), cpu()
+		: window(sf::VideoMode(640, 640), "Chip-8 Emulator"), state()
 	{
 		window.setVerticalSyncEnabled(true);
 		window.resetGLStates();
@@ -63,55 +91,167 @@ public:
 		Setup();
 
 		sf::Clock clock;
+		sf::Clock frameClock;
 		while (window.isOpen())
 		{
-			sf::Event event;
-			while (window.pollEvent(event))
+			ServeRemote();
+
+			// The first idle frame still gets drawn so a pause or breakpoint shows where it stopped
+			bool idle = state.PowerSaving && redrawFrames == 0 && IsIdle();
+			bool settled = idle && wasIdle;
+			wasIdle = idle;
+
 			{
-				ImGui::SFML::ProcessEvent(event);
+				PROFILE_ZONE("Events");
 
-				if (event.type == sf::Event::Closed)
-				{
-					window.close();
-				}
-				else if (event.type == sf::Event::Resized)
-				{
-					window.setView(sf::View(sf::FloatRect(0, 0, event.size.width, event.size.height)));
-				}
-				else
-				{
-					Process(event);
-				}
+				sf::Event event;
+				if (settled && WaitForEvent(event))
+					HandleEvent(event);
+
+				while (window.pollEvent(event))
+					HandleEvent(event);
+			}
+
+			// Nothing is running and nobody touched anything, so the last frame is still on screen
+			if (settled && redrawFrames == 0)
+				continue;
+
+			if (state.PowerSaving && state.FocusMode && redrawFrames == 0 && !DisplayChanged())
+			{
+				// Only the game is on screen and it looks the same, so keep emulating without drawing
+				HandleAudio();
+				HandleInput();
+				Emulate();
+
+				if (state.CapFramerate)
+					sf::sleep(sf::seconds(1.0f / 60.0f) - frameClock.getElapsedTime());
+				frameClock.restart();
+
+				PROFILE_FRAME();
+				continue;
 			}
 
-			window.clear();
-			ImGui::SFML::Update(window, clock.restart());
+			if (redrawFrames > 0)
+				redrawFrames--;
+
+			{
+				PROFILE_ZONE("ImGui::NewFrame");
+				window.clear();
+				ImGui::SFML::Update(window, clock.restart());
+			}
 
 			Update();
 
-			ImGui::SFML::Render(window);
-			window.display();
+			{
+				PROFILE_ZONE("ImGui::Render");
+				ImGui::SFML::Render(window);
+			}
+
+			{
+				// Includes the wait for vsync when the framerate is capped
+				PROFILE_ZONE("Display");
+				window.display();
+			}
+
+			frameClock.restart();
+			PROFILE_FRAME();
 		}
 	}
 
 private:
 	void Setup()
 	{
-		setColor = sf::Color::White;
-		unsetColor = sf::Color::Black;
-
 		PrepareBeep();
 
 		state.CapFramerate = true;
 		state.FocusMode = false;
+		state.PowerSaving = true;
+
+		AddInstance();
+
+		remote.OnFrame = [this](const Chip8& shown) { Focused().Recording.Capture(shown); };
+	}
+
+	Instance& Focused()
+	{
+		return *instances[focused];
+	}
+
+	// What the run controls act on, every instance while their input is linked so they stay in step
+	template <typename Action>
+	void ForEachTarget(Action action)
+	{
+		if (!state.LinkInput)
+		{
+			action(Focused());
+			return;
+		}
+
+		for (std::unique_ptr<Instance>& instance : instances)
+			action(*instance);
+	}
+
+	// A fresh machine, or a copy of one to try another profile or setting against
+	void AddInstance(const Instance* source = nullptr)
+	{
+		auto instance = std::make_unique<Instance>();
+		instance->Id = nextInstanceId++;
+
+		instance->Palette[0] = sf::Color::Black;
+		instance->Palette[1] = sf::Color::White;
+		instance->Palette[2] = sf::Color(170, 170, 170);
+		instance->Palette[3] = sf::Color(85, 85, 85);
+
+		for (int i = 0; i < 16; i++)
+			instance->KeyLayout[i] = i;
+
+		instance->CyclesPerFrame = ProfileCyclesPerFrame(instance->Cpu.QuirkProfile);
+		instance->DisplayTexture.setSmooth(true);
+
+		if (source)
+		{
+			instance->RomPath = source->RomPath;
+			instance->RomLength = source->RomLength;
+			instance->IsRomLoaded = source->IsRomLoaded;
+			instance->IsStateSaved = source->IsStateSaved;
+			instance->IsPaused = source->IsPaused;
+			instance->CyclesPerFrame = source->CyclesPerFrame;
+			instance->Cpu = source->Cpu;
+			instance->Breakpoints = source->Breakpoints;
+
+			for (int i = 0; i < 4; i++)
+				instance->Palette[i] = source->Palette[i];
+
+			for (int i = 0; i < 16; i++)
+				instance->KeyLayout[i] = source->KeyLayout[i];
+
+			instance->Scaler.Filter = source->Scaler.Filter;
+			instance->Scaler.ScanlineStrength = source->Scaler.ScanlineStrength;
+			instance->Scaler.PersistenceDecay = source->Scaler.PersistenceDecay;
+		}
+
+		instances.push_back(std::move(instance));
+		focused = (int)instances.size() - 1;
+		arrangePanels = true;
+	}
+
+	void CloseInstance()
+	{
+		if (instances.size() <= 1)
+			return;
+
+		instances.erase(instances.begin() + focused);
+		focused = std::min(focused, (int)instances.size() - 1);
+		arrangePanels = true;
 	}
 
 	void Update()
 	{
+		catalog.Poll();
 		RenderLoadPopup();
 
 		RenderMenu();
-		RenderDisplay();
+		RenderPanels();
 
 		if (!state.FocusMode)
 		{
@@ -119,16 +259,183 @@ private:
 			RenderProgram();
 		}
 
+		RenderProfiler();
+		RenderCheatSearch();
+
 		HandleAudio();
 		HandleInput();
+		Emulate();
+	}
+
+	// Instances only ever touch their own state here, so each one steps on a thread of its own
+	void Emulate()
+	{
+		PROFILE_ZONE("Emulate");
 
-		if (state.IsRomLoaded && !state.IsPaused)
+		workers.Run((int)instances.size(), [this](int index) { Step(*instances[index]); });
+
+		shared.Publish(Focused().Shown());
+	}
+
+	// Runs on a worker thread, which is why there are no profiler zones in here
+	void Step(Instance& instance)
+	{
+		bool ranAhead = false;
+
+		if (instance.IsRomLoaded && !instance.IsPaused)
 		{
-			cpu.ClockCycle();
+			Chip8& cpu = instance.Cpu;
+
+			instance.Scanner.ApplyFreezes(cpu);
 
-			if (breakpoints.find(cpu.ProgramCounter) != breakpoints.end())
-				state.IsPaused = true;
+			if (instance.Breakpoints.empty() && instance.Scanner.Watches().empty())
+			{
+				cpu.RunFrame(instance.CyclesPerFrame);
+				ranAhead = RunAhead(instance);
+			}
+			else
+			{
+				for (int cycle = 0; cycle < instance.CyclesPerFrame; cycle++)
+				{
+					bool vblank = cpu.ClockCycle();
+
+					if (instance.Breakpoints.find(cpu.ProgramCounter) != instance.Breakpoints.end() || instance.Scanner.CheckWatches(cpu))
+					{
+						instance.IsPaused = true;
+						break;
+					}
+
+					if (vblank)
+						break;
+				}
+
+				cpu.TickTimers();
+			}
+
+			instance.Recording.Capture(cpu);
 		}
+
+		instance.ShowingRunAhead = ranAhead;
+	}
+
+	// Emulates the next frames on a copy with the input held as it is now, so the display can
+	// show where the game will be instead of where it was. The real machine is never touched.
+	bool RunAhead(Instance& instance)
+	{
+		if (state.RunAheadFrames <= 0)
+			return false;
+
+		*instance.AheadCpu = instance.Cpu;
+		for (int frame = 0; frame < state.RunAheadFrames; frame++)
+			instance.AheadCpu->RunFrame(instance.CyclesPerFrame);
+
+		return true;
+	}
+
+	void HandleEvent(sf::Event& event)
+	{
+		// ImGui needs a few frames after any input before hover and active states settle
+		redrawFrames = IDLE_REDRAW_FRAMES;
+
+		ImGui::SFML::ProcessEvent(event);
+
+		if (event.type == sf::Event::Closed)
+		{
+			window.close();
+		}
+		else if (event.type == sf::Event::Resized)
+		{
+			window.setView(sf::View(sf::FloatRect(0, 0, event.size.width, event.size.height)));
+		}
+		else
+		{
+			Process(event);
+		}
+	}
+
+	// SFML 2.5 has no waitEvent with a timeout, so this polls in short sleeps until one arrives
+	bool WaitForEvent(sf::Event& event)
+	{
+		PROFILE_ZONE("WaitForEvent");
+
+		sf::Clock waited;
+		while (waited.getElapsedTime() < IDLE_TIMEOUT)
+		{
+			if (window.pollEvent(event))
+				return true;
+
+			// A remote request wakes the loop up as well
+			if (remote.IsListening())
+			{
+				if (remote.Wait(IDLE_POLL_INTERVAL.asMilliseconds()))
+					return false;
+			}
+			else
+				sf::sleep(IDLE_POLL_INTERVAL);
+		}
+
+		return false;
+	}
+
+	// Serves whatever the remote client sent since the last frame, see Remote.h
+	void ServeRemote()
+	{
+		if (!remote.IsListening())
+			return;
+
+		PROFILE_ZONE("Remote");
+
+		Instance& instance = Focused();
+		int events = remote.Poll(instance.Cpu, instance.Breakpoints, instance.CyclesPerFrame);
+
+		if (events & RemoteServer::CHANGED)
+		{
+			instance.Listing.Invalidate();
+			redrawFrames = IDLE_REDRAW_FRAMES;
+		}
+
+		if (events & RemoteServer::LOADED_ROM)
+			instance.IsRomLoaded = true;
+
+		if (events & RemoteServer::PAUSED)
+			instance.IsPaused = true;
+		else if (events & RemoteServer::RESUMED)
+			instance.IsPaused = false;
+	}
+
+	// True when another frame could not change anything on any instance: no rom, paused, or
+	// stuck waiting on a key or spinning in place with the timers run down. Open popups keep
+	// drawing so the file browser can show its background scan finishing.
+	bool IsIdle()
+	{
+		if (ImGui::IsPopupOpen("", ImGuiPopupFlags_AnyPopupId | ImGuiPopupFlags_AnyPopupLevel))
+			return false;
+
+		for (const std::unique_ptr<Instance>& instance : instances)
+		{
+			if (instance->IsRomLoaded && !instance->IsPaused && !instance->Cpu.IsBlocked())
+				return false;
+		}
+
+		return true;
+	}
+
+	// True if any screen or timers moved on since its panel was last drawn, or it is still fading
+	bool DisplayChanged()
+	{
+		for (const std::unique_ptr<Instance>& instance : instances)
+		{
+			const Chip8& shown = instance->Shown();
+
+			if (instance->Scaler.Fading()
+				|| memcmp(instance->DrawnGraphics, shown.Graphics, sizeof(instance->DrawnGraphics)) != 0
+				|| instance->DrawnHighResolution != shown.HighResolution
+				|| instance->DrawnDelayTimer != shown.DelayTimer
+				|| instance->DrawnSoundTimer != shown.SoundTimer)
+				return true;
+		}
+
+		return false;
 	}
 
 	void Process(sf::Event& event)
@@ -141,11 +448,14 @@ private:
 			switch (event.key.code)
 			{
 			case sf::Keyboard::F5:
-				state.IsPaused = !state.IsPaused;
+			{
+				bool pause = !Focused().IsPaused;
+				ForEachTarget([&](Instance& instance) { instance.IsPaused = pause; });
 				break;
+			}
 
 			case sf::Keyboard::F10:
-				cpu.ClockCycle();
+				ForEachTarget([](Instance& instance) { instance.Cpu.ClockCycle(); });
 				break;
 			}
 		}
@@ -153,7 +463,12 @@ private:
 
 	void RenderMenu()
 	{
+		PROFILE_ZONE("RenderMenu");
+
 		bool loadFilePopup = false;
+		Instance& instance = Focused();
+		Chip8& cpu = instance.Cpu;
+		bool hasRom = !instance.RomPath.empty();
 
 		if (ImGui::BeginMainMenuBar())
 		{
@@ -164,30 +479,77 @@ private:
 					loadFilePopup = true;
 				}
 
-				if (ImGui::MenuItem("Reset Rom"))
+				if (ImGui::MenuItem("Reset Rom", 0, false, hasRom))
 				{
-					cpu.UnloadRom();
-					LoadRomFile();
+					ForEachTarget([this](Instance& target)
+						{
+							if (target.RomPath.empty())
+								return;
+
+							target.Cpu.UnloadRom();
+							LoadRomFile(target);
+						});
 				}
 
 				if (ImGui::MenuItem("Eject Rom"))
 				{
 					cpu.UnloadRom();
-					state.IsRomLoaded = false;
+					instance.IsRomLoaded = false;
+				}
+
+				if (ImGui::MenuItem("Rescan Rom Folder", 0, false, hasRom))
+				{
+					catalog.ScanAsync(std::filesystem::path(instance.RomPath).parent_path().u8string());
+				}
+
+				ImGui::Separator();
+
+				if (ImGui::MenuItem("Save State", 0, false, hasRom))
+				{
+					instance.IsStateSaved = true;
+					DumpCpuData(instance);
+				}
+
+				if (ImGui::MenuItem("Load State", 0, false, hasRom))
+				{
+					if (instance.IsStateSaved)
+						instance.IsStateSaved = LoadCpuData(instance);
+				}
+
+				ImGui::Separator();
+
+				if (!instance.Recording.IsRecording())
+				{
+					if (ImGui::MenuItem("Record GIF", 0, false, hasRom))
+						StartRecording(instance, ".gif");
+
+					if (ImGui::MenuItem("Record Y4M", 0, false, hasRom))
+						StartRecording(instance, ".y4m");
+				}
+				else if (ImGui::MenuItem("Stop Recording"))
+				{
+					instance.Recording.Stop();
 				}
 
 				ImGui::Separator();
 
-				if (ImGui::MenuItem("Save State"))
+				// The new instance is added at the end, so instance stays valid until the menu is done
+				if (ImGui::MenuItem("New Instance"))
 				{
-					state.IsStateSaved = true;
-					DumpCpuData();
+					AddInstance();
 				}
 
-				if (ImGui::MenuItem("Load State"))
+				if (ImGui::MenuItem("Duplicate Instance"))
 				{
-					if (state.IsStateSaved)
-						LoadCpuData();
+					AddInstance(&instance);
+				}
+
+				if (ImGui::MenuItem("Close Instance", 0, false, instances.size() > 1))
+				{
+					CloseInstance();
+					ImGui::EndMenu();
+					ImGui::EndMainMenuBar();
+					return;
 				}
 
 				ImGui::EndMenu();
@@ -197,53 +559,133 @@ private:
 			{
 				if (ImGui::MenuItem("Pause", "F5"))
 				{
-					state.IsPaused = true;
+					ForEachTarget([](Instance& target) { target.IsPaused = true; });
 				}
 
 				if (ImGui::MenuItem("Step", "F10"))
 				{
-					cpu.ClockCycle();
+					ForEachTarget([](Instance& target) { target.Cpu.ClockCycle(); });
 				}
 
 				if (ImGui::MenuItem("Resume", "F5"))
 				{
-					state.IsPaused = false;
+					ForEachTarget([](Instance& target) { target.IsPaused = false; });
 				}
 
 				ImGui::Separator();
 
 				if (ImGui::MenuItem("Set Breakpoints"))
 				{
-					breakpoints.emplace(cpu.ProgramCounter);
+					instance.Breakpoints.emplace(cpu.ProgramCounter);
 				}
 
 				if (ImGui::MenuItem("Clear Breakpoints"))
 				{
-					breakpoints.clear();
+					instance.Breakpoints.clear();
 				}
 
+				ImGui::Separator();
+
+				ImGui::MenuItem("Link Input", 0, &state.LinkInput);
+				ImGui::MenuItem("Cheat Search", 0, &state.ShowCheatSearch);
+				if (ImGui::MenuItem("Remote Control", 0, remote.IsListening()))
+				{
+					if (remote.IsListening())
+						remote.Close();
+					else
+						remote.Listen((std::filesystem::temp_directory_path() / "chip8.sock").u8string());
+				}
+
+				// Publishes the focused instance for chip8_shared_view and the like, see SharedExport.h
+				if (ImGui::MenuItem("Shared Memory Export", 0, shared.IsOpen()))
+				{
+					if (shared.IsOpen())
+						shared.Close();
+					else
+						shared.Open("/chip8");
+				}
+
+#ifdef CHIP8_PROFILING
+				ImGui::Separator();
+
+				ImGui::MenuItem("Frame Timing", 0, &state.ShowProfiler);
+
+				if (ImGui::MenuItem(Profiler::IsCapturing() ? "Stop Trace Capture" : "Start Trace Capture"))
+				{
+					if (Profiler::IsCapturing())
+						Profiler::StopCapture("chip8-trace.json");
+					else
+						Profiler::StartCapture();
+				}
+#endif
+
 				ImGui::EndMenu();
 			}
 
 			if (ImGui::BeginMenu("Prefs"))
 			{
-				float setBuffer[3] = {setColor.r / 255.0f, setColor.g / 255.0f, setColor.b / 255.0f};
-				if (ImGui::ColorEdit3("Set Pixels", setBuffer))
+				const char* colorNames[] = {"Unset Pixels", "Set Pixels", "Plane 2 Pixels", "Both Planes"};
+				for (int i = 0; i < 4; i++)
 				{
-					setColor = sf::Color(setBuffer[0] * 255, setBuffer[1] * 255, setBuffer[2] * 255);
+					float buffer[3] = {instance.Palette[i].r / 255.0f, instance.Palette[i].g / 255.0f, instance.Palette[i].b / 255.0f};
+					if (ImGui::ColorEdit3(colorNames[i], buffer))
+					{
+						instance.Palette[i] = sf::Color(buffer[0] * 255, buffer[1] * 255, buffer[2] * 255);
+					}
 				}
 
-				float unsetBuffer[3] = {unsetColor.r / 255.0f, unsetColor.g / 255.0f, unsetColor.b / 255.0f};
-				if (ImGui::ColorEdit3("Unset Pixels", unsetBuffer))
+				ImGui::BeginDisabled(instance.Scaler.PersistenceDecay != 0);
+				if (ImGui::BeginCombo("Filter", ScaleFilterName(instance.Scaler.Filter)))
+				{
+					for (int i = 0; i < (int)ScaleFilter::Count; i++)
+					{
+						if (ImGui::Selectable(ScaleFilterName((ScaleFilter)i), instance.Scaler.Filter == (ScaleFilter)i))
+							instance.Scaler.Filter = (ScaleFilter)i;
+					}
+
+					ImGui::EndCombo();
+				}
+				ImGui::EndDisabled();
+
+				int scanlines = instance.Scaler.ScanlineStrength;
+				if (ImGui::SliderInt("Scanlines", &scanlines, 0, 255))
+					instance.Scaler.ScanlineStrength = (byte)scanlines;
+
+				int persistence = instance.Scaler.PersistenceDecay;
+				if (ImGui::SliderInt("Persistence", &persistence, 0, 250))
+					instance.Scaler.PersistenceDecay = (byte)persistence;
+
+				ImGui::Separator();
+
+				if (ImGui::BeginCombo("Profile", ProfileName(cpu.QuirkProfile)))
 				{
-					unsetColor = sf::Color(unsetBuffer[0] * 255, unsetBuffer[1] * 255, unsetBuffer[2] * 255);
+					for (int i = 0; i < (int)Profile::Count; i++)
+					{
+						if (ImGui::Selectable(ProfileName((Profile)i), cpu.QuirkProfile == (Profile)i))
+						{
+							cpu.SetProfile((Profile)i);
+							instance.CyclesPerFrame = ProfileCyclesPerFrame(cpu.QuirkProfile);
+
+							if (instance.IsRomLoaded)
+								LoadRomFile(instance);
+						}
+					}
+
+					ImGui::EndCombo();
 				}
 
+				ImGui::SliderInt("Cycles/Frame", &instance.CyclesPerFrame, 1, Instance::MAX_CYCLES_PER_FRAME);
+				ImGui::SliderInt("Run-Ahead Frames", &state.RunAheadFrames, 0, 4);
+
+				ImGui::Separator();
+
 				if (ImGui::Checkbox("Cap Framerate", &state.CapFramerate))
 				{
 					window.setVerticalSyncEnabled(state.CapFramerate);
 				}
 
+				ImGui::Checkbox("Power Saving", &state.PowerSaving);
+
 				if (ImGui::Checkbox("Focus Mode", &state.FocusMode))
 				{
 					window.setSize(state.FocusMode ? sf::Vector2u(640, 340) : sf::Vector2u(640, 640));
@@ -257,9 +699,9 @@ private:
 
 		if (loadFilePopup)
 		{
-			if (currentRomPath)
+			if (hasRom)
 			{
-				std::string currentRomDir = std::filesystem::path(currentRomPath).remove_filename().u8string();
+				std::string currentRomDir = std::filesystem::path(instance.RomPath).remove_filename().u8string();
 				ImGui::InitFileBrowser(currentRomDir);
 			}
 			else
@@ -269,86 +711,266 @@ private:
 		}
 	}
 
-	void RenderDisplay()
+	// Every instance's display goes in a panel of its own, and the textures are drawn along with
+	// the rest of the UI in ImGui's one render pass. A lone instance fills the top of the window
+	// without any decoration, the way the single display always did.
+	void RenderPanels()
 	{
-		sf::RectangleShape pixel({10.0f, 10.0f});
+		PROFILE_ZONE("RenderPanels");
+
+		bool single = instances.size() == 1;
+
+		// Tiled over the display area whenever one comes or goes, they can be moved around after
+		int columns = (int)std::ceil(std::sqrt((double)instances.size()));
+		int rows = ((int)instances.size() + columns - 1) / columns;
+		float cellWidth = 640.0f / columns;
+		float cellHeight = 320.0f / rows;
 
-		for (int y = 0; y < 32; y++)
+		for (int index = 0; index < (int)instances.size(); index++)
 		{
-			for (int x = 0; x < 64; x++)
+			Instance& instance = *instances[index];
+			UpdateTexture(instance);
+
+			ImGuiWindowFlags flags = ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoCollapse;
+			if (single)
+			{
+				ImGui::SetNextWindowPos({0, 20});
+				ImGui::SetNextWindowSize({640, 320});
+				flags |= ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoBackground | ImGuiWindowFlags_NoBringToFrontOnFocus;
+			}
+			else if (arrangePanels)
 			{
-				bool isSet = cpu.Graphics[y * 64 + x];
+				ImGui::SetNextWindowPos({(index % columns) * cellWidth, 20 + (index / columns) * cellHeight});
+				ImGui::SetNextWindowSize({cellWidth, cellHeight});
+			}
+
+			std::string name = instance.RomPath.empty() ? "No Rom" : std::filesystem::path(instance.RomPath).filename().u8string();
+			char title[320];
+			snprintf(title, sizeof(title), "%d: %s (%s)###panel%d", index + 1, name.c_str(), ProfileName(instance.Cpu.QuirkProfile), instance.Id);
+
+			// The focused instance keeps a lit title while the debugger windows have ImGui's focus
+			ImGui::PushStyleColor(ImGuiCol_TitleBg, ImGui::GetStyleColorVec4(index == focused ? ImGuiCol_TitleBgActive : ImGuiCol_TitleBg));
+			ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, {0, 0});
+			ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, single ? 0.0f : 1.0f);
+			bool open = ImGui::Begin(title, nullptr, flags);
+			ImGui::PopStyleVar(2);
+			ImGui::PopStyleColor();
 
-				pixel.setPosition({x * 10.0f, y * 10.0f + 20.0f});
-				pixel.setFillColor(isSet ? setColor : unsetColor);
+			if (open)
+			{
+				if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows))
+					focused = index;
+
+				// Filters that don't divide the display evenly are stretched the rest of the way
+				ImVec2 available = ImGui::GetContentRegionAvail();
+				float width = std::floor(std::min(available.x, available.y * 2));
+				float height = std::floor(width / 2);
 
-				window.draw(pixel);
+				if (width >= 2)
+				{
+					ImGui::SetCursorPosX(ImGui::GetCursorPosX() + (available.x - width) / 2);
+					ImVec2 origin = ImGui::GetCursorScreenPos();
+					ImGui::Image(instance.DisplayTexture, sf::Vector2f(width, height));
+
+					// Laid over the image so painting on it doesn't drag the panel around
+					ImGui::SetCursorScreenPos(origin);
+					ImGui::InvisibleButton("##screen", {width, height}, ImGuiButtonFlags_MouseButtonLeft | ImGuiButtonFlags_MouseButtonRight);
+					if (ImGui::IsItemActive())
+					{
+						focused = index;
+						Paint(instance.Cpu, origin, width, height);
+					}
+				}
 			}
+			ImGui::End();
+		}
+
+		arrangePanels = false;
+	}
+
+	// Sets or clears the pixel under the mouse, for a display drawn at origin
+	void Paint(Chip8& cpu, ImVec2 origin, float width, float height)
+	{
+		ImVec2 mouse = ImGui::GetMousePos();
+		float x = (mouse.x - origin.x) * cpu.DisplayWidth() / width;
+		float y = (mouse.y - origin.y) * cpu.DisplayHeight() / height;
+
+		if (x < 0 || y < 0 || x >= cpu.DisplayWidth() || y >= cpu.DisplayHeight())
+			return;
+
+		if (ImGui::IsMouseDown(ImGuiMouseButton_Left))
+			cpu.SetPixel((int)x, (int)y, 1);
+
+		if (ImGui::IsMouseDown(ImGuiMouseButton_Right))
+			cpu.SetPixel((int)x, (int)y, 0);
+	}
+
+	void UpdateTexture(Instance& instance)
+	{
+		const Chip8& shown = instance.Shown();
+
+		memcpy(instance.DrawnGraphics, shown.Graphics, sizeof(instance.DrawnGraphics));
+		instance.DrawnHighResolution = shown.HighResolution;
+		instance.DrawnDelayTimer = shown.DelayTimer;
+		instance.DrawnSoundTimer = shown.SoundTimer;
+
+		uint32_t colors[4];
+		for (int i = 0; i < 4; i++)
+			colors[i] = Upscaler::PackColor(instance.Palette[i].r, instance.Palette[i].g, instance.Palette[i].b);
+
+		// Only an actual change to the image goes through the filters and up to the GPU
+		Upscaler& scaler = instance.Scaler;
+		if (scaler.Render(shown, colors, 640, 320))
+		{
+			sf::Vector2u size = instance.DisplayTexture.getSize();
+			if (size.x != (unsigned)scaler.Width() || size.y != (unsigned)scaler.Height())
+				instance.DisplayTexture.create(scaler.Width(), scaler.Height());
+
+			instance.DisplayTexture.update((const sf::Uint8*)scaler.Pixels());
 		}
 	}
 
+	// Debugger windows show the focused instance, named after its panel once there are several
+	void DebuggerTitle(const char* name, char* title, int size)
+	{
+		if (instances.size() > 1)
+			snprintf(title, size, "%s - %d###%s", name, focused + 1, name);
+		else
+			snprintf(title, size, "%s###%s", name, name);
+	}
+
 	void RenderCpuState()
 	{
+		PROFILE_ZONE("RenderCpuState");
+
+		Instance& instance = Focused();
+
+		char title[64];
+		DebuggerTitle("CPU State", title, sizeof(title));
+
 		ImGui::SetNextWindowPos({0, 340});
 		ImGui::SetNextWindowSize({320, 300});
-		ImGui::Begin("CPU State", 0, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
+		ImGui::Begin(title, 0, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
 
 		const char* targets[] = {"Memory", "Registers", "Stack", "Graphics", "Keyboard"};
-		static int selectedTarget = 0;
 
 		ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
-		ImGui::Combo("##target", &selectedTarget, targets, sizeof(targets) / sizeof(char*));
+		ImGui::Combo("##target", &instance.CpuStateTarget, targets, sizeof(targets) / sizeof(char*));
 
-		switch (selectedTarget)
+		switch (instance.CpuStateTarget)
 		{
 		case 0:
-			RenderMemory();
+			RenderMemory(instance.Cpu, instance.Memory);
 			break;
 		case 1:
-			RenderRegisters();
+			RenderRegisters(instance.Cpu);
 			break;
 		case 2:
-			RenderStack();
+			RenderStack(instance.Cpu);
 			break;
 		case 3:
-			RenderGraphics();
+			RenderGraphics(instance.Cpu, instance.GraphicsColumn);
 			break;
 		case 4:
-			RenderKeyboard();
+			RenderKeyboard(instance.Cpu);
 			break;
 		}
 
 		ImGui::End();
 	}
 
-	void RenderMemory()
+	void RenderMemory(Chip8& cpu, MemoryView& view)
 	{
 		ImGui::Dummy({0, 10});
 
-		static int memoryStart = 0;
+		int& highlightFrames = view.HighlightFrames;
+		int& selectedAddress = view.SelectedAddress;
+		int& scrollTarget = view.ScrollTarget;
+
+		const int bytesPerRow = 8;
+		int memorySize = cpu.Target == Variant::XoChip ? MEMORY_SIZE : 0x1000;
+
+		if (ImGui::Button("Jump to I"))
+			scrollTarget = cpu.IndexRegister % memorySize;
+		ImGui::SameLine();
+		if (ImGui::Button("Jump to PC"))
+			scrollTarget = cpu.ProgramCounter % memorySize;
+		ImGui::SameLine();
 		ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
-		ImGui::DragInt("##memory_start", &memoryStart, 0.5f, 0, 4096 - 32, "%04X", ImGuiSliderFlags_NoRoundToFormat);
+		ImGui::SliderInt("##highlight_frames", &highlightFrames, 1, WRITE_HISTORY_FRAMES, "Highlight %d frames");
 
-		if (ImGui::BeginTable("##memory_table", 4))
+		if (selectedAddress >= memorySize)
+			selectedAddress = -1;
+
+		if (ImGui::BeginTable("##memory_table", bytesPerRow + 1, ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit))
 		{
-			for (int offset = 0; offset < 32; offset++)
+			ImGuiListClipper clipper;
+			clipper.Begin(memorySize / bytesPerRow);
+
+			if (scrollTarget >= 0)
+				clipper.ForceDisplayRangeByIndices(scrollTarget / bytesPerRow, scrollTarget / bytesPerRow + 1);
+
+			while (clipper.Step())
 			{
-				ImGui::TableNextColumn();
+				for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+				{
+					int rowAddress = row * bytesPerRow;
 
-				ImGui::AlignTextToFramePadding();
-				ImGui::Text("%04X:", memoryStart + offset);
-				ImGui::SameLine();
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::AlignTextToFramePadding();
+					ImGui::TextDisabled("%04X:", rowAddress);
 
-				ImGui::PushID(offset);
-				ImGui::InputScalar("##byte", ImGuiDataType_U8, &cpu.Memory[memoryStart + offset], (void*)1, (void*)32, "%X", ImGuiInputTextFlags_CharsHexadecimal);
-				ImGui::PopID();
+					if (scrollTarget >= 0 && scrollTarget / bytesPerRow == row)
+					{
+						ImGui::SetScrollHereY(0.25f);
+						selectedAddress = scrollTarget;
+						scrollTarget = -1;
+					}
+
+					for (int column = 0; column < bytesPerRow; column++)
+					{
+						int address = rowAddress + column;
+						ImGui::TableNextColumn();
+						ImGui::PushID(address);
+
+						if (address == selectedAddress)
+						{
+							// Only the selected byte gets an edit box, everything else is plain text
+							ImGui::SetNextItemWidth(ImGui::CalcTextSize("000").x);
+							if (ImGui::InputScalar("##byte", ImGuiDataType_U8, &cpu.Memory[address], nullptr, nullptr, "%02X", ImGuiInputTextFlags_CharsHexadecimal))
+								cpu.MarkDirty(address, 1);
+						}
+						else
+						{
+							// Fade from highlighted to normal as the last write gets older
+							int age = cpu.WriteAge(address);
+							ImVec4 color = ImGui::GetStyleColorVec4(ImGuiCol_Text);
+							if (age >= 0 && age < highlightFrames)
+							{
+								float fade = (float)age / highlightFrames;
+								color = {1.0f, 0.4f + 0.6f * fade, 0.2f + 0.8f * fade, 1.0f};
+							}
+
+							char text[4];
+							snprintf(text, sizeof(text), "%02X", cpu.Memory[address]);
+
+							ImGui::PushStyleColor(ImGuiCol_Text, color);
+							if (ImGui::Selectable(text, false, 0, ImGui::CalcTextSize("000")))
+								selectedAddress = address;
+							ImGui::PopStyleColor();
+						}
+
+						ImGui::PopID();
+					}
+				}
 			}
 
 			ImGui::EndTable();
 		}
 	}
 
-	void RenderRegisters()
+	void RenderRegisters(Chip8& cpu)
 	{
 		if (ImGui::BeginTable("##register_table", 4))
 		{
@@ -388,9 +1010,20 @@ private:
 		ImGui::SameLine();
 		ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x);
 		ImGui::InputScalar("##sound_timer", ImGuiDataType_U8, &cpu.SoundTimer, 0, 0, "%d");
+
+		if (cpu.Faults)
+		{
+			ImGui::Dummy({0, 10});
+			ImGui::TextColored({1, 0.3f, 0.3f, 1}, "Faults since %04X:", cpu.FaultAddress);
+			for (int kind = 0; kind < FAULT_KINDS; kind++)
+			{
+				if (cpu.Faults & (1 << kind))
+					ImGui::BulletText("%s", FaultName(kind));
+			}
+		}
 	}
 
-	void RenderStack()
+	void RenderStack(Chip8& cpu)
 	{
 		auto renderStackItem = [&](int i)
 		{
@@ -422,17 +1055,18 @@ private:
 		ImGui::SliderScalar("Stack Pointer", ImGuiDataType_U8, &cpu.StackPointer, &min, &max, "%d");
 	}
 
-	void RenderGraphics()
+	void RenderGraphics(Chip8& cpu, int& x)
 	{
 		ImGui::Dummy({0, 10});
 
-		static int x = 0;
 		ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
-		ImGui::DragInt("##pixel_start", &x, 0.1f, 0, 64 - 1, "%d");
+		ImGui::DragInt("##pixel_start", &x, 0.1f, 0, cpu.DisplayWidth() - 1, "%d");
+		if (x >= cpu.DisplayWidth())
+			x = cpu.DisplayWidth() - 1;
 
 		if (ImGui::BeginTable("##pixel_table", 4))
 		{
-			for (int y = 0; y < 32; y++)
+			for (int y = 0; y < cpu.DisplayHeight(); y++)
 			{
 				ImGui::TableNextColumn();
 
@@ -440,8 +1074,10 @@ private:
 				ImGui::Text("(%02d,%02d):", x, y);
 				ImGui::SameLine(ImGui::GetContentRegionAvail().x - 10);
 
-				ImGui::PushID(y * 64 + x);
-				ImGui::Checkbox("##pixel", &cpu.Graphics[x + y * 64 + x]);
+				ImGui::PushID(y * DISPLAY_WIDTH + x);
+				bool pixel = cpu.GetPixel(x, y) & 1;
+				if (ImGui::Checkbox("##pixel", &pixel))
+					cpu.SetPixel(x, y, (cpu.GetPixel(x, y) & ~1) | (pixel ? 1 : 0));
 				ImGui::PopID();
 			}
 
@@ -449,7 +1085,7 @@ private:
 		}
 	}
 
-	void RenderKeyboard()
+	void RenderKeyboard(Chip8& cpu)
 	{
 		ImGui::Dummy({0, 10});
 
@@ -476,59 +1112,111 @@ private:
 
 	void RenderProgram()
 	{
+		PROFILE_ZONE("RenderProgram");
+
+		Instance& instance = Focused();
+		Chip8& cpu = instance.Cpu;
+		Disassembly& disassembly = instance.Listing;
+		std::unordered_set<int>& breakpoints = instance.Breakpoints;
+
+		char title[64];
+		DebuggerTitle("Program", title, sizeof(title));
+
 		ImGui::SetNextWindowPos({320, 340});
 		ImGui::SetNextWindowSize({320, 300});
-		ImGui::Begin("Program", 0, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
+		ImGui::Begin(title, 0, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
 
-		static int scrollValue = 512;
-		ImGui::DragInt("##scroll", &scrollValue, 2, PROGRAM_START, PROGRAM_START + currentRomLength);
+		disassembly.Update(cpu);
 
-		ImGui::SameLine();
+		bool& lock = instance.Program.FollowPc;
+		int& scrollTarget = instance.Program.ScrollTarget;
+		int& lastProgramCounter = instance.Program.LastProgramCounter;
+
+		ImGui::Checkbox("Follow PC", &lock);
 
-		static bool lock = true;
-		ImGui::Checkbox("##lock_scroll", &lock);
-		if (lock)
-			scrollValue = cpu.ProgramCounter;
+		if (lock && cpu.ProgramCounter != lastProgramCounter)
+			scrollTarget = cpu.ProgramCounter;
+		lastProgramCounter = cpu.ProgramCounter;
 
-		ImGui::BeginTable("##program_table", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp);
-		ImGui::TableSetupColumn("##col_opcode", 0, 0.1f);
-		ImGui::TableSetupColumn("##col_opcode", 0, 0.15f);
-		ImGui::TableSetupColumn("##col_addr", 0, 0.15f);
-		ImGui::TableSetupColumn("##col_desc", 0, 0.6f);
+		// Rows are two bytes apart and aligned with the program counter
+		int parity = cpu.ProgramCounter & 1;
+		int rows = (disassembly.Size() - parity) / 2;
+		int targetRow = scrollTarget >= 0 ? (scrollTarget - parity) / 2 : -1;
+		int nextScrollTarget = -1;
 
-		for (int i = 0; i < 12; i += 2)
+		ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_ScrollY;
+		if (ImGui::BeginTable("##program_table", 4, flags, {0, -ImGui::GetFrameHeightWithSpacing()}))
 		{
-			ImGui::TableNextRow();
-			if (cpu.ProgramCounter == scrollValue + i)
-				ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, sf::Color::Red.toInteger());
+			ImGui::TableSetupColumn("##col_breakpoint", 0, 0.1f);
+			ImGui::TableSetupColumn("##col_addr", 0, 0.15f);
+			ImGui::TableSetupColumn("##col_opcode", 0, 0.15f);
+			ImGui::TableSetupColumn("##col_desc", 0, 0.6f);
 
-			int address = (scrollValue + i) % 4095;
-			word instruction = cpu.Memory[address] << 8 | cpu.Memory[address + 1];
-			Opcode code = Opcodes::Match(instruction);
+			ImGuiListClipper clipper;
+			clipper.Begin(rows);
+			if (targetRow >= 0 && targetRow < rows)
+				clipper.ForceDisplayRangeByIndices(targetRow, targetRow + 1);
 
-			ImGui::TableSetColumnIndex(0);
-			ImGui::PushID(address);
-			bool breakpoint = std::find(breakpoints.begin(), breakpoints.end(), address) != breakpoints.end();
-			if (ImGui::Checkbox("##breakpoint", &breakpoint))
+			while (clipper.Step())
 			{
-				if (breakpoint)
-					breakpoints.emplace(address);
-				else
-					breakpoints.erase(address);
-			}
-			ImGui::PopID();
+				for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+				{
+					int address = row * 2 + parity;
+					const DisassembledLine& line = disassembly[address];
+
+					ImGui::TableNextRow();
+					if (cpu.ProgramCounter == address)
+						ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, sf::Color::Red.toInteger());
+
+					ImGui::TableSetColumnIndex(0);
+					if (row == targetRow)
+						ImGui::SetScrollHereY(0.5f);
 
-			ImGui::TableSetColumnIndex(1);
-			ImGui::Text("%04X", address);
+					ImGui::PushID(address);
+					bool breakpoint = breakpoints.find(address) != breakpoints.end();
+					if (ImGui::Checkbox("##breakpoint", &breakpoint))
+					{
+						if (breakpoint)
+							breakpoints.emplace(address);
+						else
+							breakpoints.erase(address);
+					}
+					ImGui::PopID();
+
+					ImGui::TableSetColumnIndex(1);
+					ImGui::Text("%04X", address);
 
-			ImGui::TableSetColumnIndex(2);
-			ImGui::TextWrapped("%04X", instruction);
+					ImGui::TableSetColumnIndex(2);
+					ImGui::Text("%04X", line.Instruction);
 
-			ImGui::TableSetColumnIndex(3);
-			ImGui::TextWrapped(code.Description);
+					ImGui::TableSetColumnIndex(3);
+					if (line.Target >= 0)
+					{
+						ImGui::TextColored(ImGui::GetStyleColorVec4(ImGuiCol_ButtonHovered), "%s", line.Text);
+						if (ImGui::IsItemHovered())
+							ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
+						if (ImGui::IsItemClicked())
+							nextScrollTarget = line.Target;
+					}
+					else
+					{
+						ImGui::TextUnformatted(line.Text);
+					}
+
+					if (ImGui::IsItemHovered())
+						ImGui::SetTooltip("%s", line.Code->Description);
+				}
+			}
+
+			ImGui::EndTable();
 		}
 
-		ImGui::EndTable();
+		scrollTarget = -1;
+		if (nextScrollTarget >= 0)
+		{
+			lock = false;
+			scrollTarget = nextScrollTarget;
+		}
 
 		ImGui::AlignTextToFramePadding();
 		ImGui::Text("Program Counter:");
@@ -539,68 +1227,275 @@ private:
 		ImGui::End();
 	}
 
-	void RenderLoadPopup()
+	void RenderProfiler()
 	{
-		auto callback = [&](const char* file)
+#ifdef CHIP8_PROFILING
+		if (!state.ShowProfiler)
+			return;
+
+		ImGui::SetNextWindowPos({360, 30}, ImGuiCond_FirstUseEver);
+		if (ImGui::Begin("Frame Timing", &state.ShowProfiler, ImGuiWindowFlags_AlwaysAutoResize))
 		{
-			currentRomPath = file;
-			LoadRomFile();
+			float samples[Profiler::HISTORY_FRAMES];
+			int count = Profiler::History(Profiler::FRAME, samples);
+			Profiler::Percentiles frame = Profiler::Summarize(Profiler::FRAME);
 
-			if (std::filesystem::exists(std::filesystem::path(currentRomPath).replace_extension(".c8ss")))
-				state.IsStateSaved = true;
-		};
-		ImGui::FileBrowser(callback);
+			char overlay[64];
+			snprintf(overlay, sizeof(overlay), "p50 %.2f ms  p99 %.2f ms", frame.P50, frame.P99);
+			ImGui::PlotHistogram("##frame_times", samples, count, 0, overlay, 0.0f, std::max(frame.Max, 1000.0f / 60.0f), {240, 60});
+
+			if (ImGui::BeginTable("##zone_table", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+			{
+				ImGui::TableSetupColumn("Zone");
+				ImGui::TableSetupColumn("p50");
+				ImGui::TableSetupColumn("p99");
+				ImGui::TableSetupColumn("max");
+				ImGui::TableHeadersRow();
+
+				for (int zone = Profiler::FRAME; zone < Profiler::ZoneCount(); zone++)
+				{
+					Profiler::Percentiles times = Profiler::Summarize(zone);
+
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(Profiler::ZoneName(zone));
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f", times.P50);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f", times.P99);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f", times.Max);
+				}
+
+				ImGui::EndTable();
+			}
+
+			if (Profiler::IsCapturing())
+				ImGui::TextColored({1, 0.3f, 0.3f, 1}, "Capturing trace...");
+		}
+		ImGui::End();
+#endif
 	}
 
-	void HandleInput()
+	// Narrows memory and the registers down to the bytes holding a value, by scanning over and
+	// over as the game runs. What is found can be frozen at a value or watched to pause on a change.
+	void RenderCheatSearch()
 	{
-		ImGuiIO io = ImGui::GetIO();
+		if (!state.ShowCheatSearch)
+			return;
+
+		Instance& instance = Focused();
+		Chip8& cpu = instance.Cpu;
+		MemoryScanner& scanner = instance.Scanner;
 
-		if (!io.WantCaptureMouse)
+		char title[64];
+		DebuggerTitle("Cheat Search", title, sizeof(title));
+
+		ImGui::SetNextWindowPos({360, 200}, ImGuiCond_FirstUseEver);
+		ImGui::SetNextWindowSize({300, 420}, ImGuiCond_FirstUseEver);
+		if (ImGui::Begin(title, &state.ShowCheatSearch))
 		{
-			sf::Vector2i mouse = sf::Mouse::getPosition(window);
-			for (int y = 0; y < 32; y++)
+			ScanPredicate& predicate = instance.CheatPredicate;
+			int& value = instance.CheatValue;
+
+			if (ImGui::Button("New Scan"))
+				scanner.Start(cpu);
+
+			ImGui::SameLine();
+			ImGui::BeginDisabled(!scanner.IsScanning());
+			if (ImGui::Button("Narrow"))
+				scanner.Narrow(cpu, predicate, (byte)value);
+			ImGui::EndDisabled();
+
+			ImGui::SameLine();
+			if (scanner.IsScanning())
+				ImGui::Text("%d left", scanner.Count());
+
+			ImGui::SetNextItemWidth(120);
+			if (ImGui::BeginCombo("##predicate", ScanPredicateName(predicate)))
 			{
-				for (int x = 0; x < 64; x++)
+				for (int i = 0; i < (int)ScanPredicate::Count; i++)
 				{
-					if (sf::IntRect(x * 10, y * 10 + 20, 10, 10).contains(mouse))
-					{
-						if (sf::Mouse::isButtonPressed(sf::Mouse::Left))
-							cpu.Graphics[y * 64 + x] = true;
+					if (ImGui::Selectable(ScanPredicateName((ScanPredicate)i), predicate == (ScanPredicate)i))
+						predicate = (ScanPredicate)i;
+				}
+
+				ImGui::EndCombo();
+			}
+
+			if (predicate == ScanPredicate::EqualTo)
+			{
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(-1);
+				if (ImGui::InputInt("##value", &value))
+					value = std::clamp(value, 0, 255);
+			}
+
+			auto name = [](int address, char* text, int size)
+			{
+				if (address >= MemoryScanner::SCAN_REGISTERS)
+					snprintf(text, size, "V%X", address - MemoryScanner::SCAN_REGISTERS);
+				else
+					snprintf(text, size, "%04X", address);
+			};
+
+			char text[16];
+
+			// Only the first few thousand are listed, a fresh scan is no use until it is narrowed
+			const int MAX_LISTED = 4096;
+			listedCandidates.resize(MAX_LISTED);
+			int* listed = listedCandidates.data();
+			int count = scanner.IsScanning() ? scanner.Candidates(listed, MAX_LISTED) : 0;
 
-						if (sf::Mouse::isButtonPressed(sf::Mouse::Right))
-							cpu.Graphics[y * 64 + x] = false;
+			ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+			if (ImGui::BeginTable("##candidate_table", 4, flags, {0, 200}))
+			{
+				ImGui::TableSetupScrollFreeze(0, 1);
+				ImGui::TableSetupColumn("Address");
+				ImGui::TableSetupColumn("Was");
+				ImGui::TableSetupColumn("Now");
+				ImGui::TableSetupColumn("##actions", ImGuiTableColumnFlags_WidthFixed);
+				ImGui::TableHeadersRow();
+
+				ImGuiListClipper clipper;
+				clipper.Begin(count);
+				while (clipper.Step())
+				{
+					for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+					{
+						int address = listed[row];
+						byte now = MemoryScanner::Read(cpu, address);
+
+						ImGui::TableNextRow();
+						ImGui::PushID(address);
+
+						ImGui::TableNextColumn();
+						name(address, text, sizeof(text));
+						ImGui::TextUnformatted(text);
+						ImGui::TableNextColumn();
+						ImGui::Text("%d", scanner.Previous(address));
+						ImGui::TableNextColumn();
+						ImGui::Text("%d", now);
+
+						ImGui::TableNextColumn();
+						if (ImGui::SmallButton("Freeze"))
+							scanner.AddFreeze(address, now);
+						ImGui::SameLine();
+						if (ImGui::SmallButton("Watch"))
+							scanner.AddWatch(cpu, address);
+
+						ImGui::PopID();
 					}
 				}
+
+				ImGui::EndTable();
+			}
+
+			if (!scanner.Freezes().empty() && ImGui::CollapsingHeader("Frozen", ImGuiTreeNodeFlags_DefaultOpen))
+			{
+				// Copied, a button below can remove from the list
+				std::vector<MemoryScanner::Freeze> freezes = scanner.Freezes();
+				for (const MemoryScanner::Freeze& freeze : freezes)
+				{
+					ImGui::PushID(freeze.Address);
+
+					name(freeze.Address, text, sizeof(text));
+					ImGui::AlignTextToFramePadding();
+					ImGui::Text("%-5s", text);
+					ImGui::SameLine();
+
+					int frozen = freeze.Value;
+					ImGui::SetNextItemWidth(100);
+					if (ImGui::InputInt("##frozen", &frozen))
+						scanner.AddFreeze(freeze.Address, (byte)std::clamp(frozen, 0, 255));
+
+					ImGui::SameLine();
+					if (ImGui::SmallButton("Remove"))
+						scanner.RemoveFreeze(freeze.Address);
+
+					ImGui::PopID();
+				}
+			}
+
+			if (!scanner.Watches().empty() && ImGui::CollapsingHeader("Watched", ImGuiTreeNodeFlags_DefaultOpen))
+			{
+				std::vector<MemoryScanner::Watch> watches = scanner.Watches();
+				for (const MemoryScanner::Watch& watch : watches)
+				{
+					ImGui::PushID(watch.Address + MemoryScanner::SCAN_SIZE);
+
+					name(watch.Address, text, sizeof(text));
+					ImGui::AlignTextToFramePadding();
+					ImGui::Text("%-5s = %d", text, watch.Seen);
+
+					ImGui::SameLine();
+					if (ImGui::SmallButton("Remove"))
+						scanner.RemoveWatch(watch.Address);
+
+					ImGui::PopID();
+				}
 			}
 		}
+		ImGui::End();
+	}
+
+	void RenderLoadPopup()
+	{
+		auto callback = [&](const char* file)
+		{
+			Instance& instance = Focused();
+			instance.RomPath = file;
+
+			const RomEntry* rom = catalog.Find(instance.RomPath);
+			if (rom && rom->Known)
+				ApplyRomSettings(instance, rom->Known->Settings);
+
+			LoadRomFile(instance);
+
+			if (std::filesystem::exists(std::filesystem::path(instance.RomPath).replace_extension(".c8ss")))
+				instance.IsStateSaved = true;
+		};
+		ImGui::FileBrowser(callback);
+	}
+
+	void HandleInput()
+	{
+		PROFILE_ZONE("HandleInput");
+
+		ImGuiIO io = ImGui::GetIO();
 
 		if (!io.WantCaptureKeyboard)
 		{
-			cpu.Keyboard[0] = sf::Keyboard::isKeyPressed(sf::Keyboard::Num1);
-			cpu.Keyboard[1] = sf::Keyboard::isKeyPressed(sf::Keyboard::Num2);
-			cpu.Keyboard[2] = sf::Keyboard::isKeyPressed(sf::Keyboard::Num3);
-			cpu.Keyboard[3] = sf::Keyboard::isKeyPressed(sf::Keyboard::Num4);
+			const sf::Keyboard::Key hostKeys[16] =
+			{
+				sf::Keyboard::Num1, sf::Keyboard::Num2, sf::Keyboard::Num3, sf::Keyboard::Num4,
+				sf::Keyboard::Q, sf::Keyboard::W, sf::Keyboard::E, sf::Keyboard::R,
+				sf::Keyboard::A, sf::Keyboard::S, sf::Keyboard::D, sf::Keyboard::F,
+				sf::Keyboard::Z, sf::Keyboard::X, sf::Keyboard::C, sf::Keyboard::V
+			};
 
-			cpu.Keyboard[4] = sf::Keyboard::isKeyPressed(sf::Keyboard::Q);
-			cpu.Keyboard[5] = sf::Keyboard::isKeyPressed(sf::Keyboard::W);
-			cpu.Keyboard[6] = sf::Keyboard::isKeyPressed(sf::Keyboard::E);
-			cpu.Keyboard[7] = sf::Keyboard::isKeyPressed(sf::Keyboard::R);
+			bool held[16];
+			for (int i = 0; i < 16; i++)
+				held[i] = sf::Keyboard::isKeyPressed(hostKeys[i]);
 
-			cpu.Keyboard[8] = sf::Keyboard::isKeyPressed(sf::Keyboard::A);
-			cpu.Keyboard[9] = sf::Keyboard::isKeyPressed(sf::Keyboard::S);
-			cpu.Keyboard[10] = sf::Keyboard::isKeyPressed(sf::Keyboard::D);
-			cpu.Keyboard[11] = sf::Keyboard::isKeyPressed(sf::Keyboard::F);
+			// Instances without the input see every key let go, each maps the keys its own way
+			for (int index = 0; index < (int)instances.size(); index++)
+			{
+				Instance& instance = *instances[index];
+				bool receives = state.LinkInput || index == focused;
 
-			cpu.Keyboard[12] = sf::Keyboard::isKeyPressed(sf::Keyboard::Z);
-			cpu.Keyboard[13] = sf::Keyboard::isKeyPressed(sf::Keyboard::X);
-			cpu.Keyboard[14] = sf::Keyboard::isKeyPressed(sf::Keyboard::C);
-			cpu.Keyboard[15] = sf::Keyboard::isKeyPressed(sf::Keyboard::V);
+				for (int i = 0; i < 16; i++)
+					instance.Cpu.Keyboard[i] = receives && held[instance.KeyLayout[i]];
+			}
 		}
 	}
 
 	void HandleAudio()
 	{
+		PROFILE_ZONE("HandleAudio");
+
+		const Chip8& cpu = Focused().Cpu;
+
 		if (beeping && cpu.SoundTimer == 0)
 		{
 			beeping = false;
@@ -614,44 +1509,82 @@ private:
 		}
 	}
 
-	void DumpCpuData()
+	void DumpCpuData(Instance& instance)
 	{
-		std::string tempName = std::filesystem::path(currentRomPath).replace_extension(".c8ss").u8string();
+		std::string tempName = std::filesystem::path(instance.RomPath).replace_extension(".c8ss").u8string();
+		SnapshotHeader header = SnapshotHeader::For(instance.CyclesPerFrame);
 
 		std::ofstream file(tempName, std::ios::out | std::ios::binary);
-		file.write((char*)&cpu, sizeof(cpu));
+		file.write((char*)&header, sizeof(header));
+		file.write((char*)&instance.Cpu, sizeof(instance.Cpu));
 		file.close();
 	}
 
-	void LoadCpuData()
+	// A state from another build, an older layout or a cut short file is left alone, and the
+	// machine keeps running as it was
+	bool LoadCpuData(Instance& instance)
 	{
-		std::string tempName = std::filesystem::path(currentRomPath).replace_extension(".c8ss").u8string();
+		std::string tempName = std::filesystem::path(instance.RomPath).replace_extension(".c8ss").u8string();
 
 		std::ifstream file(tempName, std::ios::in | std::ios::binary);
-		file.read((char*)&cpu, sizeof(cpu));
-		file.close();
+
+		SnapshotHeader header;
+		if (!file.read((char*)&header, sizeof(header)) || !header.IsValid())
+			return false;
+
+		auto cpu = std::make_unique<Chip8>();
+		if (!file.read((char*)cpu.get(), sizeof(Chip8)))
+			return false;
+
+		instance.Cpu = *cpu;
+		instance.CyclesPerFrame = std::min<int>(header.CyclesPerFrame, Instance::MAX_CYCLES_PER_FRAME);
+		instance.Listing.Invalidate();
+		return true;
+	}
+
+	// Recordings go next to the rom, named after it
+	void StartRecording(Instance& instance, const char* extension)
+	{
+		uint32_t colors[4];
+		for (int i = 0; i < 4; i++)
+			colors[i] = Upscaler::PackColor(instance.Palette[i].r, instance.Palette[i].g, instance.Palette[i].b);
+
+		std::string path = std::filesystem::path(instance.RomPath).replace_extension(extension).u8string();
+		instance.Recording.Start(path, Recorder::FormatForPath(path), colors);
 	}
 
-	void LoadRomFile()
+	void LoadRomFile(Instance& instance)
 	{
-		std::ifstream file(currentRomPath, std::ios::in | std::ios::binary);
+		std::ifstream file(instance.RomPath, std::ios::in | std::ios::binary);
 
 		file.seekg(0, file.end);
-		currentRomLength = file.tellg();
+		instance.RomLength = file.tellg();
 
-		byte* code = new byte[currentRomLength];
+		byte* code = new byte[instance.RomLength];
 
 		file.seekg(0, file.beg);
-		file.read((char*)code, currentRomLength);
+		file.read((char*)code, instance.RomLength);
 
-		cpu.LoadRom(code, currentRomLength);
-		state.IsRomLoaded = true;
+		instance.Cpu.LoadRom(code, instance.RomLength);
+		instance.IsRomLoaded = true;
 
 		delete[] code;
 
 		file.close();
 	}
 
+	void ApplyRomSettings(Instance& instance, const RomSettings& settings)
+	{
+		instance.Cpu.SetProfile(settings.QuirkProfile);
+		instance.CyclesPerFrame = settings.CyclesPerFrame;
+
+		for (int i = 0; i < 4; i++)
+			instance.Palette[i] = sf::Color(settings.Palette[i]);
+
+		for (int i = 0; i < 16; i++)
+			instance.KeyLayout[i] = settings.KeyLayout[i] & 0xF;
+	}
+
 	void PrepareBeep()
 	{
 		const int SAMPLE_RATE = 44100;
@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+#include "Recorder.h"
+
+Recorder::Recorder()
+	: head(0), tail(0), stopping(false), failed(false), hasLast(false), frame(0), dropped(0),
+	file(nullptr), format(RecordFormat::Gif), scale(1), canvasWidth(0), canvasHeight(0),
+	pendingFrame(0), hasPending(false), hasWritten(false)
+{
+}
+
+Recorder::~Recorder()
+{
+	Stop();
+}
+
+RecordFormat Recorder::FormatForPath(const std::string& path)
+{
+	std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension == ".y4m" ? RecordFormat::Y4m : RecordFormat::Gif;
+}
+
+bool Recorder::Start(const std::string& path, RecordFormat format, const uint32_t palette[4], int scale)
+{
+	Stop();
+
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	this->format = format;
+	this->scale = std::max(1, scale);
+	memcpy(this->palette, palette, sizeof(this->palette));
+
+	canvasWidth = DISPLAY_WIDTH * this->scale;
+	canvasHeight = DISPLAY_HEIGHT * this->scale;
+	written.assign(DISPLAY_WIDTH * DISPLAY_HEIGHT, 0);
+	pending.assign(DISPLAY_WIDTH * DISPLAY_HEIGHT, 0);
+	current.assign(DISPLAY_WIDTH * DISPLAY_HEIGHT, 0);
+	lzwChildren.assign(format == RecordFormat::Gif ? LZW_CODES * 4 : 0, -1);
+
+	// Everything the capture side touches is allocated here, never while recording
+	queue.resize(QUEUE_FRAMES);
+	head = 0;
+	tail = 0;
+	hasLast = false;
+	frame = 0;
+	dropped = 0;
+	hasPending = false;
+	hasWritten = false;
+	stopping = false;
+	failed = false;
+
+	if (format == RecordFormat::Gif)
+		WriteGifHeader();
+	else
+		fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", canvasWidth, canvasHeight, FRAMES_PER_SECOND);
+
+	worker = std::thread(&Recorder::Work, this);
+	return true;
+}
+
+void Recorder::Stop()
+{
+	if (!file)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+
+	// The worker has drained the queue and gone, what is left is only touched from here
+	Finish(frame);
+
+	if (format == RecordFormat::Gif)
+		fputc(0x3B, file);
+
+	if (ferror(file))
+		failed = true;
+
+	fclose(file);
+	file = nullptr;
+}
+
+void Recorder::Capture(const Chip8& cpu)
+{
+	if (!file)
+		return;
+
+	uint32_t now = frame++;
+
+	if (hasLast && last.HighResolution == cpu.HighResolution && memcmp(last.Graphics, cpu.Graphics, sizeof(last.Graphics)) == 0)
+		return;
+
+	memcpy(last.Graphics, cpu.Graphics, sizeof(last.Graphics));
+	last.HighResolution = cpu.HighResolution;
+	last.Frame = now;
+
+	uint32_t position = head.load(std::memory_order_relaxed);
+	if (position - tail.load(std::memory_order_acquire) == QUEUE_FRAMES)
+	{
+		// The worker is behind, losing a frame beats stalling the emulator. Forgetting it as
+		// the last capture means the next frame goes in even if it looks the same.
+		dropped++;
+		hasLast = false;
+		return;
+	}
+
+	hasLast = true;
+	queue[position % QUEUE_FRAMES] = last;
+	head.store(position + 1, std::memory_order_release);
+	wake.notify_one();
+}
+
+void Recorder::Work()
+{
+	while (true)
+	{
+		uint32_t position = tail.load(std::memory_order_relaxed);
+
+		if (position == head.load(std::memory_order_acquire))
+		{
+			// A last frame can go in just before Stop, so head is read again once stopping is
+			// seen and the worker only leaves with the queue empty
+			if (stopping)
+			{
+				if (position == head.load(std::memory_order_acquire))
+					return;
+				continue;
+			}
+
+			// Capture never takes the lock, so the timeout covers a wakeup sent in between
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wake.wait_for(lock, std::chrono::milliseconds(20));
+			continue;
+		}
+
+		Encode(queue[position % QUEUE_FRAMES]);
+		tail.store(position + 1, std::memory_order_release);
+	}
+}
+
+void Recorder::Rasterize(const Snapshot& snapshot, std::vector<byte>& out)
+{
+	// Lo-res pixels cover two canvas pixels each way
+	int shift = snapshot.HighResolution ? 0 : 1;
+
+	for (int y = 0; y < DISPLAY_HEIGHT; y++)
+	{
+		for (int x = 0; x < DISPLAY_WIDTH; x++)
+		{
+			int sx = x >> shift, sy = y >> shift;
+			uint64_t bit = 1ull << (63 - (sx & 63));
+			byte index = 0;
+
+			for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+			{
+				if (snapshot.Graphics[plane][sy][sx >> 6] & bit)
+					index |= 1 << plane;
+			}
+
+			out[y * DISPLAY_WIDTH + x] = index;
+		}
+	}
+}
+
+// Frames are held back one step, a frame's length is only known once the next one turns up
+void Recorder::Encode(const Snapshot& snapshot)
+{
+	Rasterize(snapshot, current);
+
+	if (hasPending)
+		Finish(snapshot.Frame);
+
+	std::swap(pending, current);
+	pendingFrame = snapshot.Frame;
+	hasPending = true;
+}
+
+void Recorder::Finish(uint32_t endFrame)
+{
+	if (!hasPending)
+		return;
+
+	uint32_t frames = std::max<uint32_t>(1, endFrame - pendingFrame);
+
+	if (format == RecordFormat::Gif)
+		WriteGifFrame(pending, frames);
+	else
+		WriteY4mFrame(pending, frames);
+
+	hasPending = false;
+}
+
+// Bit packer for GIF's LSB first LZW codes, split into the 255 byte sub-blocks GIF wants
+struct GifBitWriter
+{
+	FILE* File;
+	uint32_t Bits = 0;
+	int Count = 0;
+	byte Block[255];
+	int BlockSize = 0;
+
+	explicit GifBitWriter(FILE* file) : File(file) { }
+
+	void Write(int code, int size)
+	{
+		Bits |= (uint32_t)code << Count;
+		Count += size;
+
+		while (Count >= 8)
+		{
+			Push(Bits & 0xFF);
+			Bits >>= 8;
+			Count -= 8;
+		}
+	}
+
+	void Push(byte value)
+	{
+		Block[BlockSize++] = value;
+		if (BlockSize == 255)
+			FlushBlock();
+	}
+
+	void FlushBlock()
+	{
+		if (BlockSize == 0)
+			return;
+
+		fputc(BlockSize, File);
+		fwrite(Block, 1, BlockSize, File);
+		BlockSize = 0;
+	}
+
+	void Finish()
+	{
+		if (Count > 0)
+			Push(Bits & 0xFF);
+		FlushBlock();
+		fputc(0, File);
+	}
+};
+
+static void WriteShort(FILE* file, int value)
+{
+	fputc(value & 0xFF, file);
+	fputc((value >> 8) & 0xFF, file);
+}
+
+void Recorder::WriteGifHeader()
+{
+	fwrite("GIF89a", 1, 6, file);
+	WriteShort(file, canvasWidth);
+	WriteShort(file, canvasHeight);
+
+	// Global colour table of four entries, two bits a pixel is as small as GIF goes anyway
+	fputc(0x80 | (1 << 4) | 1, file);
+	fputc(0, file);
+	fputc(0, file);
+
+	for (int i = 0; i < 4; i++)
+	{
+		byte color[4];
+		memcpy(color, &palette[i], 4);
+		fwrite(color, 1, 3, file);
+	}
+
+	// Loop forever
+	fputc(0x21, file);
+	fputc(0xFF, file);
+	fputc(11, file);
+	fwrite("NETSCAPE2.0", 1, 11, file);
+	fputc(3, file);
+	fputc(1, file);
+	WriteShort(file, 0);
+	fputc(0, file);
+}
+
+void Recorder::WriteGifFrame(const std::vector<byte>& pixels, uint32_t frames)
+{
+	// GIF counts in hundredths of a second and most viewers slow anything under two of them
+	// right down, so frame times are kept on an even grid. A frame that falls in the same slot
+	// as the next one is covered up by it before it would ever be seen.
+	auto slot = [](uint32_t frame) { return (uint32_t)((uint64_t)frame * 100 / FRAMES_PER_SECOND / 2 * 2); };
+	uint32_t start = slot(pendingFrame);
+	uint32_t delay = slot(pendingFrame + frames) - start;
+	if (delay == 0)
+		return;
+
+	// Only the box around what changed since the last written frame gets encoded
+	int left = DISPLAY_WIDTH, top = DISPLAY_HEIGHT, right = -1, bottom = -1;
+	for (int y = 0; y < DISPLAY_HEIGHT; y++)
+	{
+		for (int x = 0; x < DISPLAY_WIDTH; x++)
+		{
+			if (!hasWritten || pixels[y * DISPLAY_WIDTH + x] != written[y * DISPLAY_WIDTH + x])
+			{
+				left = std::min(left, x);
+				right = std::max(right, x);
+				top = std::min(top, y);
+				bottom = std::max(bottom, y);
+			}
+		}
+	}
+
+	// Nothing changed, a single pixel still has to go down to carry the delay
+	if (right < 0)
+		left = right = top = bottom = 0;
+
+	int width = (right - left + 1) * scale;
+	int height = (bottom - top + 1) * scale;
+
+	fputc(0x21, file);
+	fputc(0xF9, file);
+	fputc(4, file);
+	fputc(1 << 2, file);
+	WriteShort(file, delay);
+	fputc(0, file);
+	fputc(0, file);
+
+	fputc(0x2C, file);
+	WriteShort(file, left * scale);
+	WriteShort(file, top * scale);
+	WriteShort(file, width);
+	WriteShort(file, height);
+	fputc(0, file);
+
+	// LZW over a four symbol alphabet, so the dictionary is a plain 4096 x 4 child table. It
+	// belongs to this recorder, other instances encode on threads of their own.
+	const int minCodeSize = 2;
+	const int clearCode = 1 << minCodeSize;
+	const int endCode = clearCode + 1;
+
+	int16_t* children = lzwChildren.data();
+	std::fill(lzwChildren.begin(), lzwChildren.end(), -1);
+
+	fputc(minCodeSize, file);
+	GifBitWriter writer(file);
+
+	int codeSize = minCodeSize + 1;
+	int maxCode = endCode;
+	int prefix = -1;
+
+	writer.Write(clearCode, codeSize);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int value = pixels[(top + y / scale) * DISPLAY_WIDTH + left + x / scale];
+
+			if (prefix < 0)
+			{
+				prefix = value;
+				continue;
+			}
+
+			if (children[prefix * 4 + value] >= 0)
+			{
+				prefix = children[prefix * 4 + value];
+				continue;
+			}
+
+			writer.Write(prefix, codeSize);
+
+			maxCode++;
+			children[prefix * 4 + value] = (int16_t)maxCode;
+			if (maxCode >= (1 << codeSize))
+				codeSize++;
+
+			if (maxCode == LZW_CODES - 1)
+			{
+				writer.Write(clearCode, codeSize);
+				std::fill(lzwChildren.begin(), lzwChildren.end(), -1);
+				codeSize = minCodeSize + 1;
+				maxCode = endCode;
+			}
+
+			prefix = value;
+		}
+	}
+
+	// A decoder adds an entry on every code but the first, so it may widen its codes one step
+	// after the last one and the end code has to be written at that width
+	writer.Write(prefix, codeSize);
+	if (maxCode > endCode && maxCode + 1 >= (1 << codeSize) && codeSize < 12)
+		codeSize++;
+	writer.Write(endCode, codeSize);
+	writer.Finish();
+
+	written = pixels;
+	hasWritten = true;
+}
+
+void Recorder::WriteY4mFrame(const std::vector<byte>& pixels, uint32_t frames)
+{
+	// Full range BT.601, the same matrix the C420jpeg tag promises
+	byte luma[4], blue[4], red[4];
+	for (int i = 0; i < 4; i++)
+	{
+		byte color[4];
+		memcpy(color, &palette[i], 4);
+		luma[i] = (byte)std::clamp(0.299 * color[0] + 0.587 * color[1] + 0.114 * color[2], 0.0, 255.0);
+		blue[i] = (byte)std::clamp(128 - 0.168736 * color[0] - 0.331264 * color[1] + 0.5 * color[2], 0.0, 255.0);
+		red[i] = (byte)std::clamp(128 + 0.5 * color[0] - 0.418688 * color[1] - 0.081312 * color[2], 0.0, 255.0);
+	}
+
+	int chromaWidth = canvasWidth / 2;
+	int chromaHeight = canvasHeight / 2;
+	std::vector<byte> image(canvasWidth * canvasHeight + 2 * chromaWidth * chromaHeight);
+	byte* planeY = image.data();
+	byte* planeU = planeY + canvasWidth * canvasHeight;
+	byte* planeV = planeU + chromaWidth * chromaHeight;
+
+	auto at = [&](int x, int y) { return pixels[(y / scale) * DISPLAY_WIDTH + x / scale]; };
+
+	for (int y = 0; y < canvasHeight; y++)
+		for (int x = 0; x < canvasWidth; x++)
+			planeY[y * canvasWidth + x] = luma[at(x, y)];
+
+	for (int y = 0; y < chromaHeight; y++)
+	{
+		for (int x = 0; x < chromaWidth; x++)
+		{
+			byte corners[4] = {at(x * 2, y * 2), at(x * 2 + 1, y * 2), at(x * 2, y * 2 + 1), at(x * 2 + 1, y * 2 + 1)};
+			int u = 0, v = 0;
+			for (byte index : corners)
+			{
+				u += blue[index];
+				v += red[index];
+			}
+
+			planeU[y * chromaWidth + x] = (byte)((u + 2) / 4);
+			planeV[y * chromaWidth + x] = (byte)((v + 2) / 4);
+		}
+	}
+
+	// Y4M runs at a fixed rate, so a frame that lasted several is simply written several times
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		fwrite("FRAME\n", 1, 6, file);
+		fwrite(image.data(), 1, image.size(), file);
+	}
+}
@@ -0,0 +1,465 @@
+#include <algorithm>
+
+#include "Remote.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+const int HEADER_SIZE = 8;
+
+// A client that sends faster than it reads is held back rather than buffered without end. Past
+// MAX_OUTPUT unsent bytes no more requests are served, and past MAX_INPUT nothing more is read, so
+// the rest waits in the socket and the client's own sends block.
+const size_t MAX_INPUT = HEADER_SIZE + RemoteServer::MAX_PAYLOAD;
+const size_t MAX_OUTPUT = 4 * RemoteServer::MAX_PAYLOAD;
+
+static uint32_t Read32(const byte* data)
+{
+	return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static word Read16(const byte* data)
+{
+	return (word)(data[0] | data[1] << 8);
+}
+
+static void Append32(std::vector<byte>& out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back((byte)(value >> (i * 8)));
+}
+
+static void Append16(std::vector<byte>& out, word value)
+{
+	out.push_back((byte)value);
+	out.push_back((byte)(value >> 8));
+}
+
+RemoteServer::RemoteServer()
+	: listener(-1), client(-1), outputSent(0), closing(false)
+{
+}
+
+RemoteServer::~RemoteServer()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+// Windows has AF_UNIX sockets too, but behind Winsock, which nothing else here sets up
+bool RemoteServer::Listen(const std::string& path) { return false; }
+void RemoteServer::Close() { }
+bool RemoteServer::Wait(int timeoutMs) { return false; }
+void RemoteServer::Accept() { }
+bool RemoteServer::Receive() { return false; }
+void RemoteServer::Send() { }
+void RemoteServer::Disconnect() { }
+
+#else
+
+bool RemoteServer::Listen(const std::string& path)
+{
+	Close();
+
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+		return false;
+	memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+
+	// A socket file left behind by a run that didn't exit cleanly would stop bind
+	unlink(path.c_str());
+
+	if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 1) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	this->path = path;
+	listener = fd;
+	return true;
+}
+
+void RemoteServer::Close()
+{
+	Disconnect();
+
+	if (listener >= 0)
+	{
+		close(listener);
+		unlink(path.c_str());
+		listener = -1;
+	}
+}
+
+bool RemoteServer::Wait(int timeoutMs)
+{
+	if (listener < 0)
+		return false;
+
+	pollfd fd = {};
+	fd.fd = client >= 0 ? client : listener;
+	fd.events = client < 0 || input.size() < MAX_INPUT ? POLLIN : 0;
+	if (client >= 0 && outputSent < output.size())
+		fd.events |= POLLOUT;
+
+	return poll(&fd, 1, timeoutMs) > 0;
+}
+
+// One client at a time, anyone else waits in the backlog until it goes
+void RemoteServer::Accept()
+{
+	if (client >= 0 || listener < 0)
+		return;
+
+	int fd = accept(listener, nullptr, nullptr);
+	if (fd < 0)
+		return;
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	client = fd;
+}
+
+// Returns false once the client has hung up
+bool RemoteServer::Receive()
+{
+	byte buffer[16384];
+
+	while (input.size() < MAX_INPUT)
+	{
+		ssize_t count = recv(client, buffer, std::min(sizeof(buffer), MAX_INPUT - input.size()), 0);
+		if (count > 0)
+			input.insert(input.end(), buffer, buffer + count);
+		else if (count == 0)
+			return false;
+		else
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	}
+
+	return true;
+}
+
+void RemoteServer::Send()
+{
+	while (outputSent < output.size())
+	{
+		ssize_t count = send(client, output.data() + outputSent, output.size() - outputSent, SEND_FLAGS);
+		if (count > 0)
+			outputSent += count;
+		else
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				Disconnect();
+			else if (outputSent >= output.size() - outputSent)
+			{
+				// A client reading slowly never lets the buffer empty, so what it has already
+				// read goes once it outweighs what is left
+				output.erase(output.begin(), output.begin() + outputSent);
+				outputSent = 0;
+			}
+			return;
+		}
+	}
+
+	output.clear();
+	outputSent = 0;
+}
+
+void RemoteServer::Disconnect()
+{
+	if (client >= 0)
+		close(client);
+
+	client = -1;
+	input.clear();
+	output.clear();
+	outputSent = 0;
+	closing = false;
+}
+
+#endif
+
+int RemoteServer::Poll(Chip8& cpu, std::unordered_set<int>& breakpoints, int cyclesPerFrame)
+{
+	Accept();
+	if (client < 0)
+		return 0;
+
+	int events = 0;
+
+	// Answers still queued from last time go out before anything new is read
+	Send();
+	if (client < 0)
+		return DISCONNECTED;
+
+	if (!Receive())
+	{
+		Disconnect();
+		return DISCONNECTED;
+	}
+
+	size_t offset = 0;
+	std::vector<byte> reply;
+
+	while (!closing && output.size() - outputSent < MAX_OUTPUT && input.size() - offset >= HEADER_SIZE)
+	{
+		const byte* header = &input[offset];
+		uint32_t length = Read32(header);
+		word tag = Read16(header + 4);
+		byte command = header[6];
+
+		if (length > MAX_PAYLOAD)
+		{
+			Disconnect();
+			return events | DISCONNECTED;
+		}
+
+		if (input.size() - offset - HEADER_SIZE < length)
+			break;
+
+		RemoteStatus status = RemoteStatus::Ok;
+		reply.clear();
+
+		if (command < (byte)RemoteCommand::Count)
+			events |= Serve((RemoteCommand)command, header + HEADER_SIZE, length, cpu, breakpoints, cyclesPerFrame, status, reply);
+		else
+			status = RemoteStatus::UnknownCommand;
+
+		Append32(output, (uint32_t)reply.size());
+		Append16(output, tag);
+		output.push_back(command);
+		output.push_back((byte)status);
+		output.insert(output.end(), reply.begin(), reply.end());
+
+		offset += HEADER_SIZE + length;
+	}
+
+	input.erase(input.begin(), input.begin() + offset);
+	Send();
+
+	if (closing && client >= 0 && outputSent == output.size())
+		Disconnect();
+
+	if (client < 0)
+		events |= DISCONNECTED;
+
+	return events;
+}
+
+int RemoteServer::Serve(RemoteCommand command, const byte* payload, uint32_t length, Chip8& cpu,
+	std::unordered_set<int>& breakpoints, int cyclesPerFrame, RemoteStatus& status, std::vector<byte>& reply)
+{
+	// Fixed size arguments, anything shorter is rejected before it is read
+	static const uint32_t argumentSizes[(int)RemoteCommand::Count] = {0, 0, 4, 4, 2, 8, 4, 2, 2, 0, 1, 1, 0, 0, 1, 0};
+	if (length < argumentSizes[(int)command])
+	{
+		status = RemoteStatus::BadRequest;
+		return 0;
+	}
+
+	switch (command)
+	{
+	case RemoteCommand::Hello:
+		Append32(reply, PROTOCOL_VERSION);
+		reply.push_back((byte)cpu.QuirkProfile);
+		Append32(reply, cpu.Frame);
+		return 0;
+
+	case RemoteCommand::LoadRom:
+		if (length == 0 || length > MEMORY_SIZE - PROGRAM_START)
+		{
+			status = RemoteStatus::BadRequest;
+			return 0;
+		}
+
+		cpu.LoadRom((byte*)payload, (int)length);
+		return CHANGED | LOADED_ROM;
+
+	case RemoteCommand::Step:
+	{
+		uint32_t cycles = Read32(payload), run = 0;
+		while (run < cycles)
+		{
+			cpu.ClockCycle();
+			run++;
+
+			if (breakpoints.count(cpu.ProgramCounter))
+			{
+				status = RemoteStatus::Breakpoint;
+				break;
+			}
+		}
+
+		Append32(reply, run);
+		Append16(reply, cpu.ProgramCounter);
+		return CHANGED;
+	}
+
+	case RemoteCommand::RunFrames:
+	{
+		uint32_t frames = Read32(payload), run = 0;
+		while (run < frames && status == RemoteStatus::Ok)
+		{
+			if (breakpoints.empty())
+				cpu.RunFrame(cyclesPerFrame);
+			else
+			{
+				// Same as the frontend's debugger loop, a breakpoint stops mid frame with the timers as they were
+				for (int cycle = 0; cycle < cyclesPerFrame; cycle++)
+				{
+					bool vblank = cpu.ClockCycle();
+
+					if (breakpoints.count(cpu.ProgramCounter))
+					{
+						status = RemoteStatus::Breakpoint;
+						break;
+					}
+
+					if (vblank)
+						break;
+				}
+
+				if (status != RemoteStatus::Ok)
+					break;
+
+				cpu.TickTimers();
+			}
+
+			run++;
+			if (OnFrame)
+				OnFrame(cpu);
+		}
+
+		Append32(reply, run);
+		Append16(reply, cpu.ProgramCounter);
+		return CHANGED;
+	}
+
+	case RemoteCommand::SetKeys:
+	{
+		word mask = Read16(payload);
+		for (int k = 0; k < 16; k++)
+			cpu.Keyboard[k] = (mask >> k) & 1;
+		return 0;
+	}
+
+	case RemoteCommand::ReadMemory:
+	{
+		uint32_t address = Read32(payload), count = Read32(payload + 4);
+		if (address > MEMORY_SIZE || count > MEMORY_SIZE - address)
+		{
+			status = RemoteStatus::BadRequest;
+			return 0;
+		}
+
+		reply.assign(cpu.Memory + address, cpu.Memory + address + count);
+		return 0;
+	}
+
+	case RemoteCommand::WriteMemory:
+	{
+		uint32_t address = Read32(payload), count = length - 4;
+		if (address > MEMORY_SIZE || count > MEMORY_SIZE - address)
+		{
+			status = RemoteStatus::BadRequest;
+			return 0;
+		}
+
+		memcpy(cpu.Memory + address, payload + 4, count);
+		cpu.MarkDirty(address, count);
+		return CHANGED;
+	}
+
+	case RemoteCommand::SetBreakpoint:
+		breakpoints.insert(Read16(payload));
+		return 0;
+
+	case RemoteCommand::ClearBreakpoint:
+		breakpoints.erase(Read16(payload));
+		return 0;
+
+	case RemoteCommand::ClearBreakpoints:
+		breakpoints.clear();
+		return 0;
+
+	case RemoteCommand::Snapshot:
+	case RemoteCommand::Restore:
+	{
+		byte slot = payload[0];
+		if (slot >= SNAPSHOT_SLOTS || (command == RemoteCommand::Restore && !slots[slot]))
+		{
+			status = RemoteStatus::BadRequest;
+			return 0;
+		}
+
+		if (command == RemoteCommand::Restore)
+		{
+			cpu = *slots[slot];
+			return CHANGED;
+		}
+
+		if (!slots[slot])
+			slots[slot] = std::make_unique<Chip8>();
+		*slots[slot] = cpu;
+		return 0;
+	}
+
+	case RemoteCommand::Framebuffer:
+		reply.push_back(cpu.HighResolution);
+		for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+		{
+			for (int y = 0; y < DISPLAY_HEIGHT; y++)
+			{
+				for (int half = 0; half < DISPLAY_ROW_WORDS; half++)
+				{
+					uint64_t bits = cpu.Graphics[plane][y][half];
+					Append32(reply, (uint32_t)bits);
+					Append32(reply, (uint32_t)(bits >> 32));
+				}
+			}
+		}
+		return 0;
+
+	case RemoteCommand::Registers:
+		reply.insert(reply.end(), cpu.Registers, cpu.Registers + 16);
+		Append16(reply, cpu.IndexRegister);
+		Append16(reply, cpu.ProgramCounter);
+		reply.push_back(cpu.StackPointer);
+		reply.push_back(cpu.DelayTimer);
+		reply.push_back(cpu.SoundTimer);
+		for (int i = 0; i < 16; i++)
+			Append16(reply, cpu.Stack[i]);
+		return 0;
+
+	case RemoteCommand::SetPaused:
+		return payload[0] ? PAUSED : RESUMED;
+
+	case RemoteCommand::Close:
+		closing = true;
+		return 0;
+
+	default:
+		status = RemoteStatus::UnknownCommand;
+		return 0;
+	}
+}
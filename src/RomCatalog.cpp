@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "RomCatalog.h"
+#include "Sha1.h"
+
+#define DEFAULT_PALETTE {0x000000FF, 0xFFFFFFFF, 0xAAAAAAFF, 0x555555FF}
+#define GREEN_PALETTE {0x081A0CFF, 0x33FF66FF, 0x1F9940FF, 0x145A28FF}
+#define AMBER_PALETTE {0x1A0F00FF, 0xFFB000FF, 0xB37B00FF, 0x664600FF}
+
+// Key k on the host slot of KeyLayout[k]. DEFAULT runs the keys 0-F across the grid in order,
+// KEYPAD puts them where they sit on the COSMAC VIP hex keypad:
+//
+//   1 2 3 C      1 2 3 4
+//   4 5 6 D  ->  Q W E R
+//   7 8 9 E      A S D F
+//   A 0 B F      Z X C V
+//
+// The MOVE layouts are KEYPAD with a game's four direction keys moved onto WASD, 2468 also puts
+// the fire key 5 on E
+#define DEFAULT_LAYOUT {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}
+#define KEYPAD_LAYOUT {13, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 14, 3, 7, 11, 15}
+#define MOVE_2468_LAYOUT {13, 0, 5, 2, 8, 6, 10, 4, 9, 1, 12, 14, 3, 7, 11, 15}
+#define MOVE_3678_LAYOUT {13, 0, 1, 5, 4, 2, 9, 8, 10, 6, 12, 14, 3, 7, 11, 15}
+
+const char* RomCatalog::IndexName = "chip8.index";
+const RomSettings RomCatalog::DefaultSettings = {Profile::Modern, 10, DEFAULT_PALETTE, DEFAULT_LAYOUT};
+
+// Sorted by hash so lookups can binary search. Titles from the COSMAC VIP days get its quirks,
+// the CHIP-48 era ones rely on the modern shift and load/store behaviour.
+static const KnownRom knownRoms[] =
+{
+	{"050f07a54371da79f924dd0227b89d07b4f2aed0", "Hidden", {Profile::Modern, 10, DEFAULT_PALETTE, MOVE_2468_LAYOUT}},
+	{"0d0cc129dad3c45ba672f85fec71a668232212cc", "Missile Command", {Profile::Modern, 10, GREEN_PALETTE, KEYPAD_LAYOUT}},
+	{"1293db0ccccbe7dd3fc5a09a2abc5d7b175e18e0", "Puzzle", {Profile::CosmacVip, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"18b9d15f4c159e1f0ed58c2d8ec1d89325d3a3b6", "Tank", {Profile::Modern, 10, GREEN_PALETTE, MOVE_2468_LAYOUT}},
+	{"1bdb4ddaa7049266fa3226851f28855a365cfd12", "Syzygy", {Profile::Modern, 15, AMBER_PALETTE, MOVE_3678_LAYOUT}},
+	{"2d10c07b532f4fa7c07a07324ba26ca39fe484fd", "Connect 4", {Profile::Modern, 10, DEFAULT_PALETTE, MOVE_2468_LAYOUT}},
+	{"429d455a4bc53167942bf6fd934d72b0f648dce3", "Tic-Tac-Toe", {Profile::Modern, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"5260f8931e0e9f41e555b382a14a88368e3ed886", "Guess", {Profile::Modern, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"5f518084744bf3cb8733f6e5454dfd1634320563", "Tetris", {Profile::Modern, 15, AMBER_PALETTE, KEYPAD_LAYOUT}},
+	{"6f6509f38220e057a7e32ebb22dd353c1078e3e7", "Blitz", {Profile::Modern, 10, GREEN_PALETTE, MOVE_2468_LAYOUT}},
+	{"a60611339661e3ab2d8af024ad1da5880a6f8665", "Pong 2", {Profile::Modern, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"ade839585ddeb0e3633177df03c1d91589e629eb", "Vers", {Profile::Modern, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"b232ef880bd6060fb45fa6effed7edf0ae95670e", "Pong", {Profile::Modern, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"b9272ae1acdaaa79ab649f6b48b72088ca2b1d74", "Maze", {Profile::CosmacVip, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"bdb92475acfe11bc7814a2f5eade13fcd09b756a", "UFO", {Profile::Modern, 10, GREEN_PALETTE, MOVE_2468_LAYOUT}},
+	{"d40abc54374e4343639f993e897e00904ddf85d9", "Blinky", {Profile::Modern, 20, AMBER_PALETTE, MOVE_3678_LAYOUT}},
+	{"d666688a8fce468a7d88b536bc1ef5f35ba12031", "Wipe Off", {Profile::CosmacVip, 10, DEFAULT_PALETTE, MOVE_2468_LAYOUT}},
+	{"d6fa9dc9005dc0496f39ba52fef56f9fd0a5a158", "Kaleidoscope", {Profile::CosmacVip, 15, DEFAULT_PALETTE, MOVE_2468_LAYOUT}},
+	{"d979858bb9ffd07b48f52f92a8bcac0199f3623e", "Merlin", {Profile::Modern, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"da710f631f8e35534d0b9170bcf892a60f49c43d", "Vertical Brix", {Profile::Modern, 10, AMBER_PALETTE, KEYPAD_LAYOUT}},
+	{"ea9af3c09b0d9e265fcd92bcc5d51a2939fdf27a", "15 Puzzle", {Profile::CosmacVip, 10, DEFAULT_PALETTE, KEYPAD_LAYOUT}},
+	{"f100197f0f2f05b4f3c8c31ab9c2c3930d3e9571", "Space Invaders", {Profile::Modern, 15, GREEN_PALETTE, MOVE_2468_LAYOUT}},
+	{"f13766c14aeb02ad8d4d103cb5eadd282d20cddc", "Brix", {Profile::Modern, 10, AMBER_PALETTE, MOVE_2468_LAYOUT}}
+};
+
+namespace fs = std::filesystem;
+
+static std::string NormalizePath(const fs::path& path)
+{
+	std::error_code error;
+	fs::path absolute = fs::absolute(path, error);
+	return (error ? path : absolute).lexically_normal().u8string();
+}
+
+static int64_t ModifiedTime(const fs::path& path, std::error_code& error)
+{
+	return fs::last_write_time(path, error).time_since_epoch().count();
+}
+
+static std::string HashFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file)
+		return "";
+
+	std::vector<byte> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return Sha1(data.data(), data.size());
+}
+
+void RomCatalog::RunScan(CatalogScan& scan)
+{
+	const std::string& dir = scan.Directory;
+
+	std::unordered_map<std::string, RomEntry> cached;
+	ReadIndex(dir, cached);
+
+	std::vector<RomEntry>& found = scan.Found;
+	std::vector<size_t> stale;
+
+	std::error_code error;
+	for (const auto& entry : fs::directory_iterator(dir, error))
+	{
+		std::error_code entryError;
+		if (!entry.is_regular_file(entryError))
+			continue;
+
+		if (entry.path().filename() == IndexName || entry.path().extension() == ".c8ss")
+			continue;
+
+		uintmax_t size = entry.file_size(entryError);
+		if (entryError || size == 0 || size > MEMORY_SIZE - PROGRAM_START)
+			continue;
+
+		RomEntry rom{entry.path().lexically_normal().u8string(), size, ModifiedTime(entry.path(), entryError), "", nullptr};
+
+		auto it = cached.find(rom.Path);
+		if (it != cached.end() && it->second.Size == rom.Size && it->second.ModifiedTime == rom.ModifiedTime)
+			rom.Hash = it->second.Hash;
+		else
+			stale.push_back(found.size());
+
+		found.push_back(rom);
+	}
+
+	// Hashing is the slow part of a first scan, so the stale files are shared out between threads
+	std::atomic<size_t> next(0);
+	auto worker = [&]()
+	{
+		for (size_t i = next++; i < stale.size(); i = next++)
+		{
+			RomEntry& rom = found[stale[i]];
+			rom.Hash = HashFile(rom.Path);
+		}
+	};
+
+	size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), stale.size());
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& thread : threads)
+		thread.join();
+
+	for (RomEntry& rom : found)
+		rom.Known = Identify(rom.Hash);
+
+	if (!stale.empty() || cached.size() != found.size())
+		WriteIndex(dir, found);
+
+	scan.Hashed = (int)stale.size();
+	scan.Done = true;
+}
+
+void RomCatalog::Merge(CatalogScan& scan)
+{
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (fs::path(it->first).parent_path().u8string() == scan.Directory)
+			it = entries.erase(it);
+		else
+			++it;
+	}
+
+	for (RomEntry& rom : scan.Found)
+		entries[rom.Path] = rom;
+}
+
+int RomCatalog::Scan(const std::string& directory)
+{
+	CatalogScan scan;
+	scan.Directory = NormalizePath(directory);
+
+	RunScan(scan);
+	Merge(scan);
+
+	return scan.Hashed;
+}
+
+void RomCatalog::ScanAsync(const std::string& directory)
+{
+	std::string dir = NormalizePath(directory);
+	for (const auto& scan : scans)
+	{
+		if (scan->Directory == dir)
+			return;
+	}
+
+	auto scan = std::make_shared<CatalogScan>();
+	scan->Directory = dir;
+	scans.push_back(scan);
+
+	std::thread([scan]() { RunScan(*scan); }).detach();
+}
+
+bool RomCatalog::Poll()
+{
+	bool merged = false;
+
+	for (auto it = scans.begin(); it != scans.end();)
+	{
+		if ((*it)->Done)
+		{
+			Merge(**it);
+			it = scans.erase(it);
+			merged = true;
+		}
+		else
+			++it;
+	}
+
+	return merged;
+}
+
+const RomEntry* RomCatalog::Find(const std::string& path)
+{
+	std::string key = NormalizePath(path);
+
+	std::error_code error;
+	uintmax_t size = fs::file_size(key, error);
+	int64_t modified = ModifiedTime(key, error);
+	if (error)
+		return nullptr;
+
+	auto it = entries.find(key);
+	if (it != entries.end() && it->second.Size == size && it->second.ModifiedTime == modified)
+		return &it->second;
+
+	std::string hash = HashFile(key);
+	if (hash.empty())
+		return nullptr;
+
+	ScanAsync(fs::path(key).parent_path().u8string());
+
+	RomEntry& rom = entries[key];
+	rom = RomEntry{key, size, modified, hash, Identify(hash)};
+	return &rom;
+}
+
+const KnownRom* RomCatalog::Identify(const std::string& hash)
+{
+	auto it = std::lower_bound(std::begin(knownRoms), std::end(knownRoms), hash,
+		[](const KnownRom& rom, const std::string& value) { return value.compare(rom.Hash) > 0; });
+
+	if (it != std::end(knownRoms) && hash == it->Hash)
+		return it;
+
+	return nullptr;
+}
+
+void RomCatalog::ReadIndex(const std::string& directory, std::unordered_map<std::string, RomEntry>& cached)
+{
+	std::ifstream file((fs::path(directory) / IndexName).u8string());
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		std::istringstream fields(line);
+		RomEntry rom{"", 0, 0, "", nullptr};
+		std::string name;
+
+		fields >> rom.Hash >> rom.Size >> rom.ModifiedTime;
+		fields.get();
+		std::getline(fields, name);
+
+		if (!fields.fail() && !name.empty())
+		{
+			rom.Path = (fs::path(directory) / fs::u8path(name)).lexically_normal().u8string();
+			cached[rom.Path] = rom;
+		}
+	}
+}
+
+void RomCatalog::WriteIndex(const std::string& directory, const std::vector<RomEntry>& roms)
+{
+	std::ofstream file((fs::path(directory) / IndexName).u8string(), std::ios::out | std::ios::trunc);
+
+	for (const RomEntry& rom : roms)
+	{
+		if (rom.Hash.empty())
+			continue;
+
+		file << rom.Hash << ' ' << rom.Size << ' ' << rom.ModifiedTime << ' ' << fs::path(rom.Path).filename().u8string() << '\n';
+	}
+}
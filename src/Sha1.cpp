@@ -0,0 +1,88 @@
+#include "Sha1.h"
+
+static uint32_t Rotate(uint32_t value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+static void ProcessBlock(const byte* block, uint32_t state[5])
+{
+	uint32_t w[80];
+	for (int i = 0; i < 16; i++)
+		w[i] = block[i * 4] << 24 | block[i * 4 + 1] << 16 | block[i * 4 + 2] << 8 | block[i * 4 + 3];
+	for (int i = 16; i < 80; i++)
+		w[i] = Rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+	for (int i = 0; i < 80; i++)
+	{
+		uint32_t f, k;
+		if (i < 20)
+		{
+			f = (b & c) | (~b & d);
+			k = 0x5A827999;
+		}
+		else if (i < 40)
+		{
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		}
+		else if (i < 60)
+		{
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8F1BBCDC;
+		}
+		else
+		{
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+
+		uint32_t temp = Rotate(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = Rotate(b, 30);
+		b = a;
+		a = temp;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+std::string Sha1(const byte* data, size_t len)
+{
+	uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+	size_t offset = 0;
+	for (; offset + 64 <= len; offset += 64)
+		ProcessBlock(data + offset, state);
+
+	// The tail, the 0x80 terminator and the bit length need one or two more blocks
+	byte tail[128] = {};
+	size_t remaining = len - offset;
+	memcpy(tail, data + offset, remaining);
+	tail[remaining] = 0x80;
+
+	size_t tailLength = remaining < 56 ? 64 : 128;
+	uint64_t bits = (uint64_t)len * 8;
+	for (int i = 0; i < 8; i++)
+		tail[tailLength - 1 - i] = (byte)(bits >> (i * 8));
+
+	for (size_t block = 0; block < tailLength; block += 64)
+		ProcessBlock(tail + block, state);
+
+	const char* hex = "0123456789abcdef";
+	std::string digest;
+	for (int i = 0; i < 5; i++)
+	{
+		for (int shift = 28; shift >= 0; shift -= 4)
+			digest += hex[(state[i] >> shift) & 0xF];
+	}
+
+	return digest;
+}
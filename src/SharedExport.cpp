@@ -0,0 +1,119 @@
+#include <string.h>
+
+#include "SharedExport.h"
+#include "Chip8Shared.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(chip8_shared_state::graphics) == sizeof(Chip8::Graphics), "shared display out of step with the core");
+
+SharedExport::SharedExport()
+	: segment(nullptr), sequence(0)
+{
+}
+
+SharedExport::~SharedExport()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool SharedExport::Open(const std::string& name) { return false; }
+void SharedExport::Close() { }
+void SharedExport::Publish(const Chip8& cpu) { }
+
+#else
+
+bool SharedExport::Open(const std::string& segmentName)
+{
+	Close();
+
+	int fd = shm_open(segmentName.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return false;
+
+	if (ftruncate(fd, sizeof(chip8_shared_segment)) != 0)
+	{
+		close(fd);
+		shm_unlink(segmentName.c_str());
+		return false;
+	}
+
+	void* mapped = mmap(nullptr, sizeof(chip8_shared_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (mapped == MAP_FAILED)
+	{
+		shm_unlink(segmentName.c_str());
+		return false;
+	}
+
+	segment = (chip8_shared_segment*)mapped;
+	name = segmentName;
+
+	// A segment left behind by an earlier run carries on from its sequence, so a reader that was
+	// attached the whole time never sees it go backwards
+	sequence = __atomic_load_n(&segment->sequence, __ATOMIC_RELAXED) & ~1ull;
+
+	segment->magic = CHIP8_SHARED_MAGIC;
+	segment->version = CHIP8_SHARED_VERSION;
+	segment->size = sizeof(chip8_shared_segment);
+	__atomic_store_n(&segment->flags, 0, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+void SharedExport::Close()
+{
+	if (!segment)
+		return;
+
+	__atomic_store_n(&segment->flags, CHIP8_SHARED_CLOSED, __ATOMIC_RELEASE);
+
+	// Readers already attached keep their mapping, only the name goes
+	munmap(segment, sizeof(chip8_shared_segment));
+	shm_unlink(name.c_str());
+
+	segment = nullptr;
+	name.clear();
+}
+
+void SharedExport::Publish(const Chip8& cpu)
+{
+	if (!segment)
+		return;
+
+	// Built on the stack first so the window where readers have to retry is a single copy
+	chip8_shared_state state = {};
+	state.frame = cpu.Frame;
+	memcpy(state.graphics, cpu.Graphics, sizeof(state.graphics));
+
+	for (int k = 0; k < 16; k++)
+		state.keys |= (uint16_t)(cpu.Keyboard[k] ? 1 << k : 0);
+
+	state.program_counter = cpu.ProgramCounter;
+	state.index_register = cpu.IndexRegister;
+	memcpy(state.stack, cpu.Stack, sizeof(state.stack));
+	memcpy(state.registers, cpu.Registers, sizeof(state.registers));
+	state.delay_timer = cpu.DelayTimer;
+	state.sound_timer = cpu.SoundTimer;
+	state.stack_pointer = cpu.StackPointer;
+	state.high_resolution = cpu.HighResolution;
+	state.profile = (uint8_t)cpu.QuirkProfile;
+	state.faults = cpu.Faults;
+
+	__atomic_store_n(&segment->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(&segment->state, &state, sizeof(state));
+
+	sequence += 2;
+	__atomic_store_n(&segment->sequence, sequence, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,568 @@
+#include <algorithm>
+#include <stdlib.h>
+
+#include "Upscaler.h"
+
+// SSE2 is part of every x86-64 target, AVX2 only when the build asks for it (CHIP8_AVX2)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UPSCALER_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+const char* ScaleFilterName(ScaleFilter filter)
+{
+	switch (filter)
+	{
+	case ScaleFilter::Scale2x: return "Scale2x";
+	case ScaleFilter::Scale3x: return "Scale3x";
+	case ScaleFilter::Xbr: return "xBR";
+	default: return "Nearest";
+	}
+}
+
+uint32_t Upscaler::PackColor(byte r, byte g, byte b, byte a)
+{
+	byte bytes[4] = {r, g, b, a};
+	uint32_t color;
+	memcpy(&color, bytes, sizeof(color));
+	return color;
+}
+
+// Per channel average of two packed colours, works the same whatever the byte order
+static uint32_t Blend(uint32_t a, uint32_t b)
+{
+	return (((a ^ b) & 0xFEFEFEFE) >> 1) + (a & b);
+}
+
+Upscaler::Upscaler()
+	: Filter(ScaleFilter::Nearest), ScanlineStrength(0), PersistenceDecay(0), indexStride(0), sourceWidth(0), sourceHeight(0),
+	filteredWidth(0), filteredHeight(0), width(0), height(0), fading(), rowsChanged(), valid(false)
+{
+}
+
+bool Upscaler::Fading() const
+{
+	if (!valid || !PersistenceDecay)
+		return false;
+
+	return std::any_of(fading, fading + sourceHeight, [](bool row) { return row; });
+}
+
+bool Upscaler::Render(const Chip8& cpu, const uint32_t palette[4], int maxWidth, int maxHeight)
+{
+	bool current = valid && drawnHighResolution == cpu.HighResolution && memcmp(drawnPalette, palette, sizeof(drawnPalette)) == 0
+		&& drawnFilter == Filter && drawnScanlineStrength == ScanlineStrength && drawnPersistenceDecay == PersistenceDecay
+		&& drawnMaxWidth == maxWidth && drawnMaxHeight == maxHeight;
+
+	// Persistence works out the rows that changed itself, against the frame drawn last
+	bool persisted = false;
+	if (PersistenceDecay)
+		persisted = Persist(cpu, palette, current);
+	else if (current && memcmp(drawnGraphics, cpu.Graphics, sizeof(drawnGraphics)) == 0)
+		return false;
+
+	memcpy(drawnGraphics, cpu.Graphics, sizeof(drawnGraphics));
+	drawnHighResolution = cpu.HighResolution;
+	memcpy(drawnPalette, palette, sizeof(drawnPalette));
+	drawnFilter = Filter;
+	drawnScanlineStrength = ScanlineStrength;
+	drawnPersistenceDecay = PersistenceDecay;
+	drawnMaxWidth = maxWidth;
+	drawnMaxHeight = maxHeight;
+	valid = true;
+
+	if (PersistenceDecay)
+	{
+		if (!persisted)
+			return false;
+
+		int scale = std::max(1, std::min(maxWidth / filteredWidth, maxHeight / filteredHeight));
+		Expand(scale, current ? rowsChanged : nullptr);
+		return true;
+	}
+
+	Unpack(cpu);
+
+	switch (Filter)
+	{
+	case ScaleFilter::Scale2x:
+		Scale2x();
+		Lookup(scaledIndices.data(), palette);
+		break;
+
+	case ScaleFilter::Scale3x:
+		Scale3x();
+		Lookup(scaledIndices.data(), palette);
+		break;
+
+	case ScaleFilter::Xbr:
+		Xbr(palette);
+		break;
+
+	default:
+		filteredWidth = sourceWidth;
+		filteredHeight = sourceHeight;
+		scaledIndices.resize(sourceWidth * sourceHeight);
+		for (int y = 0; y < sourceHeight; y++)
+			memcpy(&scaledIndices[y * sourceWidth], &indices[(y + BORDER_ROWS) * indexStride + BORDER_COLUMNS], sourceWidth);
+		Lookup(scaledIndices.data(), palette);
+		break;
+	}
+
+	int scale = std::max(1, std::min(maxWidth / filteredWidth, maxHeight / filteredHeight));
+	Expand(scale);
+
+	return true;
+}
+
+void Upscaler::Unpack(const Chip8& cpu)
+{
+	sourceWidth = cpu.DisplayWidth();
+	sourceHeight = cpu.DisplayHeight();
+	indexStride = sourceWidth + 2 * BORDER_COLUMNS;
+	indices.resize(indexStride * (sourceHeight + 2 * BORDER_ROWS));
+
+	for (int y = 0; y < sourceHeight; y++)
+	{
+		byte* row = &indices[(y + BORDER_ROWS) * indexStride];
+
+		for (int half = 0; half < sourceWidth / 64; half++)
+		{
+			uint64_t plane0 = cpu.Graphics[0][y][half];
+			uint64_t plane1 = cpu.Graphics[1][y][half];
+
+			for (int bit = 0; bit < 64; bit++)
+				row[BORDER_COLUMNS + half * 64 + bit] = (byte)((plane0 >> (63 - bit) & 1) | (plane1 >> (63 - bit) & 1) << 1);
+		}
+
+		memset(row, row[BORDER_COLUMNS], BORDER_COLUMNS);
+		memset(row + BORDER_COLUMNS + sourceWidth, row[BORDER_COLUMNS + sourceWidth - 1], BORDER_COLUMNS);
+	}
+
+	for (int border = 0; border < BORDER_ROWS; border++)
+	{
+		memcpy(&indices[border * indexStride], &indices[BORDER_ROWS * indexStride], indexStride);
+		memcpy(&indices[(sourceHeight + BORDER_ROWS + border) * indexStride], &indices[(sourceHeight + BORDER_ROWS - 1) * indexStride], indexStride);
+	}
+}
+
+// EPX / Scale2x: a corner takes the colour of its two neighbours when they agree and the
+// pixel is not part of a straight line
+void Upscaler::Scale2x()
+{
+	filteredWidth = sourceWidth * 2;
+	filteredHeight = sourceHeight * 2;
+	scaledIndices.resize(filteredWidth * filteredHeight);
+
+	for (int y = 0; y < sourceHeight; y++)
+	{
+		const byte* up = &indices[(y + BORDER_ROWS - 1) * indexStride + BORDER_COLUMNS];
+		const byte* center = up + indexStride;
+		const byte* down = center + indexStride;
+		byte* top = &scaledIndices[(y * 2) * filteredWidth];
+		byte* bottom = top + filteredWidth;
+
+		int x = 0;
+
+#ifdef UPSCALER_SSE2
+		// Sixteen pixels at a time, the source width is always a multiple of 64
+		for (; x + 16 <= sourceWidth; x += 16)
+		{
+			__m128i b = _mm_loadu_si128((const __m128i*)(up + x));
+			__m128i h = _mm_loadu_si128((const __m128i*)(down + x));
+			__m128i d = _mm_loadu_si128((const __m128i*)(center + x - 1));
+			__m128i e = _mm_loadu_si128((const __m128i*)(center + x));
+			__m128i f = _mm_loadu_si128((const __m128i*)(center + x + 1));
+
+			__m128i edge = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(b, h), _mm_cmpeq_epi8(d, f)), _mm_set1_epi8(-1));
+
+			__m128i e0Mask = _mm_and_si128(edge, _mm_cmpeq_epi8(d, b));
+			__m128i e1Mask = _mm_and_si128(edge, _mm_cmpeq_epi8(b, f));
+			__m128i e2Mask = _mm_and_si128(edge, _mm_cmpeq_epi8(d, h));
+			__m128i e3Mask = _mm_and_si128(edge, _mm_cmpeq_epi8(h, f));
+
+			__m128i e0 = _mm_or_si128(_mm_and_si128(e0Mask, d), _mm_andnot_si128(e0Mask, e));
+			__m128i e1 = _mm_or_si128(_mm_and_si128(e1Mask, f), _mm_andnot_si128(e1Mask, e));
+			__m128i e2 = _mm_or_si128(_mm_and_si128(e2Mask, d), _mm_andnot_si128(e2Mask, e));
+			__m128i e3 = _mm_or_si128(_mm_and_si128(e3Mask, f), _mm_andnot_si128(e3Mask, e));
+
+			_mm_storeu_si128((__m128i*)(top + x * 2), _mm_unpacklo_epi8(e0, e1));
+			_mm_storeu_si128((__m128i*)(top + x * 2 + 16), _mm_unpackhi_epi8(e0, e1));
+			_mm_storeu_si128((__m128i*)(bottom + x * 2), _mm_unpacklo_epi8(e2, e3));
+			_mm_storeu_si128((__m128i*)(bottom + x * 2 + 16), _mm_unpackhi_epi8(e2, e3));
+		}
+#endif
+
+		for (; x < sourceWidth; x++)
+		{
+			byte b = up[x], h = down[x], d = center[x - 1], e = center[x], f = center[x + 1];
+			bool edge = b != h && d != f;
+
+			top[x * 2] = edge && d == b ? d : e;
+			top[x * 2 + 1] = edge && b == f ? f : e;
+			bottom[x * 2] = edge && d == h ? d : e;
+			bottom[x * 2 + 1] = edge && h == f ? f : e;
+		}
+	}
+}
+
+// Scale3x, the same idea over a 3x3 block. Nine outputs per pixel do not interleave cleanly in
+// SSE registers and the source is at most 8 K pixels, so this one stays scalar.
+void Upscaler::Scale3x()
+{
+	filteredWidth = sourceWidth * 3;
+	filteredHeight = sourceHeight * 3;
+	scaledIndices.resize(filteredWidth * filteredHeight);
+
+	for (int y = 0; y < sourceHeight; y++)
+	{
+		for (int x = 0; x < sourceWidth; x++)
+		{
+			byte a = Index(x - 1, y - 1), b = Index(x, y - 1), c = Index(x + 1, y - 1);
+			byte d = Index(x - 1, y), e = Index(x, y), f = Index(x + 1, y);
+			byte g = Index(x - 1, y + 1), h = Index(x, y + 1), i = Index(x + 1, y + 1);
+
+			byte out[9] = {e, e, e, e, e, e, e, e, e};
+			if (b != h && d != f)
+			{
+				out[0] = d == b ? d : e;
+				out[1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+				out[2] = b == f ? f : e;
+				out[3] = (d == b && e != g) || (d == h && e != a) ? d : e;
+				out[5] = (b == f && e != i) || (h == f && e != c) ? f : e;
+				out[6] = d == h ? d : e;
+				out[7] = (d == h && e != i) || (h == f && e != g) ? h : e;
+				out[8] = h == f ? f : e;
+			}
+
+			for (int row = 0; row < 3; row++)
+				memcpy(&scaledIndices[(y * 3 + row) * filteredWidth + x * 3], out + row * 3, 3);
+		}
+	}
+}
+
+// A 2x take on xBR level 1: each corner looks for an edge running across it by comparing the
+// colour gradients along both diagonals of a 5x5 neighbourhood, and blends towards the
+// neighbour on the far side of the edge when it finds one
+void Upscaler::Xbr(const uint32_t palette[4])
+{
+	filteredWidth = sourceWidth * 2;
+	filteredHeight = sourceHeight * 2;
+	filtered.resize(filteredWidth * filteredHeight);
+
+	// Distances between palette entries, weighted in YUV like the original filter
+	int distance[4][4];
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			byte first[4], second[4];
+			memcpy(first, &palette[i], 4);
+			memcpy(second, &palette[j], 4);
+
+			int r = first[0] - second[0], g = first[1] - second[1], b = first[2] - second[2];
+			int luma = (r * 299 + g * 587 + b * 114) / 1000;
+			int u = (-r * 169 - g * 331 + b * 500) / 1000;
+			int v = (r * 500 - g * 419 - b * 81) / 1000;
+			distance[i][j] = abs(luma) * 48 + abs(u) * 7 + abs(v) * 6;
+		}
+	}
+
+	for (int y = 0; y < sourceHeight; y++)
+	{
+		for (int x = 0; x < sourceWidth; x++)
+		{
+			byte e = Index(x, y);
+			uint32_t* out = &filtered[(y * 2) * filteredWidth + x * 2];
+
+			// With all four direct neighbours the same colour any blend lands back on that colour
+			if (Index(x, y - 1) == e && Index(x - 1, y) == e && Index(x + 1, y) == e && Index(x, y + 1) == e)
+			{
+				out[0] = out[1] = out[filteredWidth] = out[filteredWidth + 1] = palette[e];
+				continue;
+			}
+
+			for (int corner = 0; corner < 4; corner++)
+			{
+				// Mirror the neighbourhood so every corner is worked out as the bottom right one
+				int sx = (corner & 1) ? 1 : -1;
+				int sy = (corner & 2) ? 1 : -1;
+				auto at = [&](int dx, int dy) { return Index(x + dx * sx, y + dy * sy); };
+
+				byte b = at(0, -1), c = at(1, -1), d = at(-1, 0), f = at(1, 0);
+				byte g = at(-1, 1), h = at(0, 1), i = at(1, 1);
+				byte f4 = at(2, 0), i4 = at(2, 1), h5 = at(0, 2), i5 = at(1, 2);
+
+				int across = distance[e][c] + distance[e][g] + distance[i][f4] + distance[i][h5] + 4 * distance[h][f];
+				int along = distance[h][d] + distance[h][i5] + distance[f][i4] + distance[f][b] + 4 * distance[e][i];
+
+				uint32_t color = palette[e];
+				if (across < along)
+					color = Blend(color, palette[distance[e][f] <= distance[e][h] ? f : h]);
+
+				out[((corner & 2) ? filteredWidth : 0) + (corner & 1)] = color;
+			}
+		}
+	}
+}
+
+void Upscaler::Lookup(const byte* source, const uint32_t palette[4])
+{
+	int count = filteredWidth * filteredHeight;
+	filtered.resize(count);
+	uint32_t* out = filtered.data();
+
+	int i = 0;
+
+#ifdef UPSCALER_SSE2
+	// With only four colours a compare per entry beats a gather
+	__m128i zero = _mm_setzero_si128();
+	__m128i colors[4], keys[4];
+	for (int c = 0; c < 4; c++)
+	{
+		colors[c] = _mm_set1_epi32((int)palette[c]);
+		keys[c] = _mm_set1_epi32(c);
+	}
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(source + i));
+		__m128i words[2] = {_mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero)};
+
+		for (int quarter = 0; quarter < 4; quarter++)
+		{
+			__m128i lanes = (quarter & 1) ? _mm_unpackhi_epi16(words[quarter >> 1], zero) : _mm_unpacklo_epi16(words[quarter >> 1], zero);
+
+			__m128i color = _mm_and_si128(_mm_cmpeq_epi32(lanes, keys[0]), colors[0]);
+			for (int c = 1; c < 4; c++)
+				color = _mm_or_si128(color, _mm_and_si128(_mm_cmpeq_epi32(lanes, keys[c]), colors[c]));
+
+			_mm_storeu_si128((__m128i*)(out + i + quarter * 4), color);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = palette[source[i] & 3];
+}
+
+// Copies one colour into count pixels
+static void Fill(uint32_t* out, uint32_t color, int count)
+{
+#if defined(__AVX2__)
+	if (count >= 8)
+	{
+		__m256i wide = _mm256_set1_epi32((int)color);
+		for (int i = 0; i + 8 <= count; i += 8)
+			_mm256_storeu_si256((__m256i*)(out + i), wide);
+		if (count % 8)
+			_mm256_storeu_si256((__m256i*)(out + count - 8), wide);
+		return;
+	}
+#endif
+
+#ifdef UPSCALER_SSE2
+	// Overlapping the last store is cheaper than a tail loop
+	if (count >= 4)
+	{
+		__m128i value = _mm_set1_epi32((int)color);
+		for (int i = 0; i + 4 <= count; i += 4)
+			_mm_storeu_si128((__m128i*)(out + i), value);
+		if (count % 4)
+			_mm_storeu_si128((__m128i*)(out + count - 4), value);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < count; i++)
+		out[i] = color;
+}
+
+// Scales every channel but alpha by (256 - strength) / 256
+static void Darken(uint32_t* row, int count, byte strength)
+{
+	uint32_t alpha = Upscaler::PackColor(0, 0, 0, 255);
+	int keep = 256 - strength;
+	int i = 0;
+
+#ifdef UPSCALER_SSE2
+	__m128i zero = _mm_setzero_si128();
+	__m128i factor = _mm_set1_epi16((short)keep);
+	__m128i alphaMask = _mm_set1_epi32((int)alpha);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(row + i));
+		__m128i low = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), factor), 8);
+		__m128i high = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), factor), 8);
+		__m128i darkened = _mm_packus_epi16(low, high);
+
+		_mm_storeu_si128((__m128i*)(row + i), _mm_or_si128(_mm_andnot_si128(alphaMask, darkened), _mm_and_si128(alphaMask, pixels)));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		byte channels[4];
+		memcpy(channels, &row[i], 4);
+		for (int c = 0; c < 4; c++)
+			channels[c] = (byte)(channels[c] * keep >> 8);
+
+		uint32_t darkened;
+		memcpy(&darkened, channels, 4);
+		row[i] = (darkened & ~alpha) | (row[i] & alpha);
+	}
+}
+
+// Decays the glow of every row that changed or is still fading and colours those rows at the
+// source resolution, returns false if no row needed it
+bool Upscaler::Persist(const Chip8& cpu, const uint32_t palette[4], bool current)
+{
+	if (!current)
+	{
+		sourceWidth = cpu.DisplayWidth();
+		sourceHeight = cpu.DisplayHeight();
+		filteredWidth = sourceWidth;
+		filteredHeight = sourceHeight;
+		filtered.resize(sourceWidth * sourceHeight);
+		glow.assign(DISPLAY_PLANES * sourceWidth * sourceHeight, 0);
+
+		// Every mix of the two planes' glow, blended between the four colours they select
+		byte colors[4][4];
+		memcpy(colors, palette, sizeof(colors));
+
+		for (int a = 0; a < GLOW_LEVELS; a++)
+		{
+			for (int b = 0; b < GLOW_LEVELS; b++)
+			{
+				float wa = a / (float)(GLOW_LEVELS - 1);
+				float wb = b / (float)(GLOW_LEVELS - 1);
+				byte mixed[4];
+
+				for (int c = 0; c < 4; c++)
+				{
+					float value = colors[0][c] * (1 - wa) * (1 - wb) + colors[1][c] * wa * (1 - wb)
+						+ colors[2][c] * (1 - wa) * wb + colors[3][c] * wa * wb;
+					mixed[c] = (byte)(value + 0.5f);
+				}
+
+				memcpy(&glowPalette[a * GLOW_LEVELS + b], mixed, 4);
+			}
+		}
+	}
+
+	bool any = false;
+
+	for (int y = 0; y < sourceHeight; y++)
+	{
+		bool changed = !current || memcmp(drawnGraphics[0][y], cpu.Graphics[0][y], sizeof(cpu.Graphics[0][y])) != 0
+			|| memcmp(drawnGraphics[1][y], cpu.Graphics[1][y], sizeof(cpu.Graphics[1][y])) != 0;
+
+		rowsChanged[y] = changed || fading[y];
+		if (!rowsChanged[y])
+			continue;
+
+		fading[y] = DecayRow(cpu, y);
+
+		const byte* plane0 = &glow[y * sourceWidth];
+		const byte* plane1 = plane0 + sourceWidth * sourceHeight;
+		uint32_t* out = &filtered[y * sourceWidth];
+
+		for (int x = 0; x < sourceWidth; x++)
+			out[x] = glowPalette[(plane0[x] * GLOW_LEVELS >> 8) * GLOW_LEVELS + (plane1[x] * GLOW_LEVELS >> 8)];
+
+		any = true;
+	}
+
+	return any;
+}
+
+// Fades one row of glow and max-blends the pixels lit now back in at full strength, returns
+// true while any of it is still somewhere between off and on
+bool Upscaler::DecayRow(const Chip8& cpu, int y)
+{
+	bool settled = true;
+
+#ifdef UPSCALER_SSE2
+	__m128i zero = _mm_setzero_si128();
+	__m128i factor = _mm_set1_epi16(PersistenceDecay);
+	__m128i select = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+		(char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+#endif
+
+	for (int plane = 0; plane < DISPLAY_PLANES; plane++)
+	{
+		for (int half = 0; half < sourceWidth / 64; half++)
+		{
+			byte* row = &glow[(plane * sourceHeight + y) * sourceWidth + half * 64];
+			uint64_t bits = cpu.Graphics[plane][y][half];
+			int x = 0;
+
+#ifdef UPSCALER_SSE2
+			for (; x < 64; x += 16)
+			{
+				// Sixteen pixels' bits spread out to a byte each, all ones where the pixel is lit
+				int chunk = (int)(bits >> (48 - x) & 0xFFFF);
+				__m128i spread = _mm_unpacklo_epi64(_mm_set1_epi8((char)(chunk >> 8)), _mm_set1_epi8((char)chunk));
+				__m128i lit = _mm_cmpeq_epi8(_mm_and_si128(spread, select), select);
+
+				__m128i value = _mm_loadu_si128((const __m128i*)(row + x));
+				__m128i low = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(value, zero), factor), 8);
+				__m128i high = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(value, zero), factor), 8);
+				__m128i blended = _mm_max_epu8(_mm_packus_epi16(low, high), lit);
+
+				_mm_storeu_si128((__m128i*)(row + x), blended);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(blended, lit)) != 0xFFFF)
+					settled = false;
+			}
+#endif
+
+			for (; x < 64; x++)
+			{
+				byte lit = (bits >> (63 - x) & 1) ? 255 : 0;
+				byte blended = std::max((byte)(row[x] * PersistenceDecay >> 8), lit);
+
+				row[x] = blended;
+				settled &= blended == lit;
+			}
+		}
+	}
+
+	return !settled;
+}
+
+// Rows is an optional mask of the filtered rows to redo, the rest are left as they are
+void Upscaler::Expand(int scale, const bool* rows)
+{
+	width = filteredWidth * scale;
+	height = filteredHeight * scale;
+	pixels.resize(width * height);
+
+	// The bottom third of every block is the gap between scanlines
+	int gapRows = ScanlineStrength && scale > 1 ? std::max(1, scale / 3) : 0;
+
+	for (int y = 0; y < filteredHeight; y++)
+	{
+		if (rows && !rows[y])
+			continue;
+
+		const uint32_t* source = &filtered[y * filteredWidth];
+		uint32_t* first = &pixels[(y * scale) * width];
+
+		if (scale == 1)
+			memcpy(first, source, width * sizeof(uint32_t));
+		else
+			for (int x = 0; x < filteredWidth; x++)
+				Fill(first + x * scale, source[x], scale);
+
+		for (int row = 1; row < scale; row++)
+			memcpy(first + row * width, first, width * sizeof(uint32_t));
+
+		for (int row = scale - gapRows; row < scale; row++)
+			Darken(first + row * width, width, ScanlineStrength);
+	}
+}
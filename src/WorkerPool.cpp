@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads)
+	: job(nullptr), count(0), next(0), busy(0), batch(0), stopping(false)
+{
+	if (threads < 0)
+		threads = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+
+	for (int i = 0; i < threads; i++)
+		workers.emplace_back(&WorkerPool::Work, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void WorkerPool::Run(int jobs, const std::function<void(int)>& run)
+{
+	// Not worth waking anyone for a single job
+	if (jobs <= 1 || workers.empty())
+	{
+		for (int i = 0; i < jobs; i++)
+			run(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		job = &run;
+		count = jobs;
+		next = 0;
+		busy = (int)workers.size();
+		batch++;
+	}
+	wake.notify_all();
+
+	Drain();
+
+	// Every worker checks out of the batch, even one that found nothing left to take
+	std::unique_lock<std::mutex> guard(lock);
+	finished.wait(guard, [this] { return busy == 0; });
+	job = nullptr;
+}
+
+void WorkerPool::Drain()
+{
+	for (int i = next++; i < count; i = next++)
+		(*job)(i);
+}
+
+void WorkerPool::Work()
+{
+	uint64_t seen = 0;
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (true)
+	{
+		wake.wait(guard, [&] { return stopping || batch != seen; });
+		if (stopping)
+			return;
+
+		seen = batch;
+
+		guard.unlock();
+		Drain();
+		guard.lock();
+
+		if (--busy == 0)
+			finished.notify_one();
+	}
+}
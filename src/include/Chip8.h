@@ -1,6 +1,8 @@
 #pragma once
 #include <string.h>
+#include <stdint.h>
 #include <functional>
+#include <type_traits>
 
 #define ARRAYLEN(x) (sizeof(x) / sizeof(*x))
 
@@ -9,34 +11,177 @@ typedef unsigned short word;
 
 const int PROGRAM_START = 512;
 
+// XO-CHIP addresses the full 16 bit range, the other variants just never reach past 4 KB
+const int MEMORY_SIZE = 0x10000;
+const int MEMORY_MASK = MEMORY_SIZE - 1;
+
+// The framebuffer is always sized for SUPER-CHIP hi-res, every row is a 128 bit span packed
+// into two words with the leftmost pixel in the highest bit, so lo-res only touches word 0
+const int DISPLAY_WIDTH = 128;
+const int DISPLAY_HEIGHT = 64;
+const int DISPLAY_PLANES = 2;
+const int DISPLAY_ROW_WORDS = DISPLAY_WIDTH / 64;
+
+// How many frames a write stays visible through Chip8::WriteAge
+const int WRITE_HISTORY_FRAMES = 64;
+
+// Write stamps are swept a page at a time, and only in pages written since their last sweep
+const int STAMP_PAGE_SIZE = 256;
+const int STAMP_PAGES = MEMORY_SIZE / STAMP_PAGE_SIZE;
+
+// Things a program did that real hardware would have crashed on or done nothing for, collected
+// in Chip8::Faults. Emulation carries on regardless, the stack index wraps to stay in bounds.
+const byte FAULT_STACK_OVERFLOW = 1 << 0;	// a call with all 16 stack slots in use
+const byte FAULT_STACK_UNDERFLOW = 1 << 1;	// a return with nothing on the stack
+const byte FAULT_INDEX_RANGE = 1 << 2;		// I reached past 4 KB outside XO-CHIP
+const byte FAULT_UNKNOWN_OPCODE = 1 << 3;	// an instruction the variant doesn't have, run as a no-op
+const int FAULT_KINDS = 4;
+
+const char* FaultName(int kind);
+
 struct Opcode;
 
+enum class Variant : byte
+{
+	Chip8,
+	SuperChip,
+	XoChip
+};
+
+// Quirk profiles, see Quirks.h for what each of them means
+enum class Profile : byte
+{
+	CosmacVip,
+	Modern,
+	SuperChip,
+	XoChip,
+	Count
+};
+
 class Chip8
 {
 public:
-	byte Memory[4096];
+	Profile QuirkProfile;
+	Variant Target;
+
+	byte Memory[MEMORY_SIZE];
 	word ProgramCounter;
-	
-	byte Registers[16]; 
+
+	byte Registers[16];
 	word IndexRegister;
-	
-	bool Graphics[64 * 32];
+
+	uint64_t Graphics[DISPLAY_PLANES][DISPLAY_HEIGHT][DISPLAY_ROW_WORDS];
+	bool HighResolution;
+	byte PlaneMask;
+
 	bool Keyboard[16];
-	
+
 	byte DelayTimer;
 	byte SoundTimer;
 
-	byte StackPointer; 
+	byte StackPointer;
 	word Stack[16];
 
+	byte Flags[16];
+	byte AudioPattern[16];
+	byte Pitch;
+
+	// Span of memory written since the debugger last looked, empty while DirtyStart >= DirtyEnd
+	uint32_t DirtyStart;
+	uint32_t DirtyEnd;
+
+	// Frame each byte was last written in, as the low 7 bits of Frame with the top bit marking
+	// the stamp as live. Stamps older than WRITE_HISTORY_FRAMES are swept back to zero.
+	byte WriteStamps[MEMORY_SIZE];
+	uint64_t StampedPages[STAMP_PAGES / 64];
+	uint32_t Frame;
+
+	// Xorshift state behind Cxkk, part of the object so save states replay the same numbers
+	uint32_t RandomState;
+
+	// FAULT_ flags raised since the rom was loaded, and where the first of them happened
+	byte Faults;
+	word FaultAddress;
+
 public:
 	Chip8();
 
 	void LoadRom(byte* code, int len);
 	void UnloadRom();
 
-	void ClockCycle();
-	
+	void SetProfile(Profile profile);
+	void SeedRandom(uint32_t seed);
+
+	byte NextRandom()
+	{
+		RandomState ^= RandomState << 13;
+		RandomState ^= RandomState >> 17;
+		RandomState ^= RandomState << 5;
+		return (byte)(RandomState >> 24);
+	}
+
+	void RaiseFault(byte fault)
+	{
+		if (!Faults)
+			FaultAddress = ProgramCounter;
+		Faults |= fault;
+	}
+
+	void MarkDirty(uint32_t address, uint32_t length)
+	{
+		byte stamp = (Frame & 0x7F) | 0x80;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			uint32_t target = (address + i) & MEMORY_MASK;
+			WriteStamps[target] = stamp;
+			StampedPages[target / STAMP_PAGE_SIZE / 64] |= 1ull << (target / STAMP_PAGE_SIZE % 64);
+		}
+
+		uint32_t end = address + length;
+		if (end > MEMORY_SIZE)
+		{
+			address = 0;
+			end = MEMORY_SIZE;
+		}
+
+		DirtyStart = address < DirtyStart ? address : DirtyStart;
+		DirtyEnd = end > DirtyEnd ? end : DirtyEnd;
+	}
+
+	// True if running on can't change anything until a key goes down, see Chip8.cpp
+	bool IsBlocked() const;
+
+	bool ClockCycle();
+	int RunFrame(int cycles);
+	void TickTimers();
+
+	// Frames since address was last written, or -1 if that is longer than WRITE_HISTORY_FRAMES
+	int WriteAge(word address) const
+	{
+		byte stamp = WriteStamps[address];
+		int age = (Frame - stamp) & 0x7F;
+		return stamp && age < WRITE_HISTORY_FRAMES ? age : -1;
+	}
+
+	int DisplayWidth() const { return HighResolution ? DISPLAY_WIDTH : DISPLAY_WIDTH / 2; }
+	int DisplayHeight() const { return HighResolution ? DISPLAY_HEIGHT : DISPLAY_HEIGHT / 2; }
+
+	byte GetPixel(int x, int y) const;
+	void SetPixel(int x, int y, byte planes);
+
+	void ClearDisplay();
+	template <bool Wrap>
+	bool DrawSprite(int x, int y, int width, int height);
+	void ScrollDown(int rows);
+	void ScrollUp(int rows);
+	void ScrollLeft(int columns);
+	void ScrollRight(int columns);
+	void SetResolution(bool high);
+
 private:
 	void ResetCpu();
-};
\ No newline at end of file
+	void SweepWriteStamps();
+};
+
+// Save states and run-ahead snapshots are plain copies of the object, nothing in here may own memory
+static_assert(std::is_trivially_copyable<Chip8>::value, "Chip8 must stay trivially copyable");
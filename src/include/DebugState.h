@@ -1,9 +1,13 @@
 #pragma once
+
+// Frontend settings shared by every instance, see Instance.h for what each machine keeps
 struct DebugState
 {
-	bool IsRomLoaded;
-	bool IsStateSaved;
-	bool IsPaused;
 	bool CapFramerate;
 	bool FocusMode;
-};
\ No newline at end of file
+	bool PowerSaving;
+	bool ShowProfiler;
+	bool ShowCheatSearch;
+	bool LinkInput;
+	int RunAheadFrames;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+
+#include "Chip8.h"
+#include "Opcode.h"
+
+struct DisassembledLine
+{
+	word Instruction;
+	const Opcode* Code;
+
+	// Destination of a jump or call, -1 for everything else
+	int Target;
+	char Text[24];
+};
+
+// Every address of the cpu's memory decoded up front, so the debugger only ever reads from here.
+// Update patches just the bytes the cpu reported as written since the last call.
+class Disassembly
+{
+private:
+	std::vector<DisassembledLine> lines;
+	Variant target;
+
+public:
+	Disassembly();
+
+	void Update(Chip8& cpu);
+	void Invalidate();
+
+	int Size() const { return (int)lines.size(); }
+	const DisassembledLine& operator[](int address) const { return lines[address]; }
+
+	static void Decode(const Chip8& cpu, word address, DisassembledLine& line);
+
+private:
+	void Rebuild(const Chip8& cpu);
+};
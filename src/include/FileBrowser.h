@@ -1,15 +1,53 @@
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <filesystem>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
 #include <imgui.h>
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #pragma once
 
 namespace ImGui
 {
+	struct FileBrowserEntry
+	{
+		std::string Path;
+		std::string Label;
+		std::string SizeText;
+		bool IsDirectory;
+	};
+
+	// One directory listing, filled in on a background thread and handed over once Done is set
+	struct FileBrowserScan
+	{
+		std::string Directory;
+		std::vector<FileBrowserEntry> Entries;
+		bool Exists = false;
+		std::atomic<bool> Done{false};
+	};
+
 	static char dirBuffer[256];
 	static char selectedFileBuffer[256];
 	static int selectedIndex = -1;
 
+	static std::string listedDir;
+	static std::shared_ptr<FileBrowserScan> listing;
+	static std::shared_ptr<FileBrowserScan> pendingListing;
+
+#ifdef __linux__
+	static int watchFd = -1;
+	static int watchDescriptor = -1;
+#endif
+
 	static void strcpy(std::string &src, char *dst)
 	{
 		int len = src.length();
@@ -17,10 +55,103 @@ namespace ImGui
 		dst[len] = '\0';
 	}
 
+	static std::string FormatFileSize(uintmax_t size)
+	{
+		char buffer[32];
+		if (size < 1024)
+			snprintf(buffer, sizeof(buffer), "%d B", (int)size);
+		else if (size < 1024 * 1024)
+			snprintf(buffer, sizeof(buffer), "%.1f KB", size / 1024.0);
+		else
+			snprintf(buffer, sizeof(buffer), "%.1f MB", size / (1024.0 * 1024.0));
+		return buffer;
+	}
+
+	static void ScanDirectory(std::shared_ptr<FileBrowserScan> scan)
+	{
+		std::error_code error;
+		scan->Exists = std::filesystem::is_directory(scan->Directory, error);
+
+		if (scan->Exists)
+		{
+			for (const auto &entry : std::filesystem::directory_iterator(scan->Directory, error))
+			{
+				std::error_code entryError;
+				FileBrowserEntry item;
+				item.Path = entry.path().u8string();
+				item.IsDirectory = entry.is_directory(entryError);
+				item.Label = (item.IsDirectory ? "[D] " : "[F] ") + entry.path().filename().u8string();
+
+				if (!item.IsDirectory)
+				{
+					uintmax_t size = entry.file_size(entryError);
+					item.SizeText = entryError ? "" : FormatFileSize(size);
+				}
+
+				scan->Entries.push_back(std::move(item));
+			}
+
+			std::sort(scan->Entries.begin(), scan->Entries.end(), [](const FileBrowserEntry &a, const FileBrowserEntry &b)
+				{
+					if (a.IsDirectory != b.IsDirectory)
+						return a.IsDirectory;
+					return a.Label < b.Label;
+				});
+		}
+
+		scan->Done = true;
+	}
+
+	static void WatchDirectory(const std::string &dir)
+	{
+#ifdef __linux__
+		if (watchFd < 0)
+			watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+		if (watchFd < 0)
+			return;
+
+		if (watchDescriptor >= 0)
+			inotify_rm_watch(watchFd, watchDescriptor);
+
+		watchDescriptor = inotify_add_watch(watchFd, dir.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF);
+#endif
+	}
+
+	// True if the watched directory changed since the last call, always false without inotify
+	static bool DirectoryChanged()
+	{
+		bool changed = false;
+#ifdef __linux__
+		if (watchFd < 0)
+			return false;
+
+		char events[4096];
+		while (read(watchFd, events, sizeof(events)) > 0)
+			changed = true;
+#endif
+		return changed;
+	}
+
+	static void RefreshListing(bool force = false)
+	{
+		std::string dir = dirBuffer;
+		if (!force && dir == listedDir)
+			return;
+
+		listedDir = dir;
+		pendingListing = std::make_shared<FileBrowserScan>();
+		pendingListing->Directory = dir;
+		std::thread(ScanDirectory, pendingListing).detach();
+
+		WatchDirectory(dir);
+	}
+
 	void InitFileBrowser(std::string startDir = "")
 	{
 		std::string currentDir = startDir != "" ? startDir : std::filesystem::current_path().u8string();
 		strcpy(currentDir, dirBuffer);
+		RefreshListing(true);
 
 		ImGui::OpenPopup("LoadRom");
 	}
@@ -32,48 +163,91 @@ namespace ImGui
 
 		if (ImGui::BeginPopupModal("LoadRom", 0, ImGuiWindowFlags_AlwaysAutoResize))
 		{
-			ImGui::InputText("##file", dirBuffer, 255);
+			if (ImGui::InputText("##file", dirBuffer, 255))
+				RefreshListing();
+
+			if (DirectoryChanged())
+				RefreshListing(true);
 
-			if (std::filesystem::exists(dirBuffer))
+			if (pendingListing && pendingListing->Done)
 			{
-				if (ImGui::ListBoxHeader("##entry_list"))
+				listing = pendingListing;
+				pendingListing = nullptr;
+
+				// Keep the selection across a refresh of the same directory
+				selectedIndex = -1;
+				for (int index = 0; index < (int)listing->Entries.size(); index++)
 				{
-					int index = 0;
-					for (const auto &entry : std::filesystem::directory_iterator(dirBuffer))
-					{
-						ImGui::Text(std::filesystem::is_directory(entry) ? "[D]" : "[F]");
-						ImGui::SameLine(30);
+					if (listing->Entries[index].Path == selectedFileBuffer)
+						selectedIndex = index;
+				}
+			}
 
-						std::string current = entry.path().u8string();
-						std::string fileNameString = entry.path().filename().u8string();
+			if (listing && listing->Exists)
+			{
+				if (ImGui::BeginListBox("##entry_list"))
+				{
+					std::string navigateTo;
 
-						ImGui::PushID(index);
-						if (ImGui::Selectable(fileNameString.c_str(), selectedIndex == index))
+					ImGuiListClipper clipper;
+					clipper.Begin((int)listing->Entries.size());
+					while (clipper.Step())
+					{
+						for (int index = clipper.DisplayStart; index < clipper.DisplayEnd; index++)
 						{
-							if (std::filesystem::is_directory(entry))
+							const FileBrowserEntry &entry = listing->Entries[index];
+
+							ImGui::PushID(index);
+							if (ImGui::Selectable(entry.Label.c_str(), selectedIndex == index))
 							{
-								strcpy(current, dirBuffer);
-								selectedIndex = -1;
+								if (entry.IsDirectory)
+								{
+									navigateTo = entry.Path;
+									selectedIndex = -1;
+								}
+								else
+								{
+									std::string current = entry.Path;
+									strcpy(current, selectedFileBuffer);
+									selectedIndex = index;
+								}
 							}
-							else
+
+							if (!entry.IsDirectory)
 							{
-								strcpy(current, selectedFileBuffer);
-								selectedIndex = index;
+								ImGui::SameLine(ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(entry.SizeText.c_str()).x);
+								ImGui::TextDisabled("%s", entry.SizeText.c_str());
 							}
+							ImGui::PopID();
 						}
-						ImGui::PopID();
-
-						index++;
 					}
 
-					ImGui::ListBoxFooter();
+					ImGui::EndListBox();
+
+					if (!navigateTo.empty())
+					{
+						strcpy(navigateTo, dirBuffer);
+						RefreshListing();
+					}
 				}
 			}
+			else if (pendingListing)
+			{
+				ImGui::TextDisabled("Loading...");
+			}
 
 			if (ImGui::ArrowButton("##dir_up", ImGuiDir_Up))
 			{
 				std::string parentString = std::filesystem::path(dirBuffer).parent_path().u8string();
 				strcpy(parentString, dirBuffer);
+				RefreshListing();
+			}
+
+			ImGui::SameLine();
+
+			if (ImGui::Button("Refresh"))
+			{
+				RefreshListing(true);
 			}
 
 			ImGui::SameLine();
@@ -94,4 +268,4 @@ namespace ImGui
 			ImGui::EndPopup();
 		}
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,216 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "Chip8.h"
+#include "Interpreter.h"
+
+// Superinstructions, the short sequences hot loops are made of, each run as a single dispatch.
+// A sequence only ever calls the interpreter's own handlers in order, so it does exactly what
+// stepping through it would.
+enum class Fusion : byte
+{
+	None,
+	IndexDraw,	// Annn Dxyn
+	LoadRun,	// two to four 6xkk in a row
+	TimerPoll,	// Fx07 3xkk 1nnn on the same Vx, waiting for the delay timer
+	CountLoop,	// 7xkk 3xkk on the same Vx, a loop counter
+	IndexLoad,	// Fx1E Fx65
+	Count
+};
+
+const char* FusionName(Fusion kind);
+
+// What each address of memory decodes to, built as addresses are first run. Every entry keeps the
+// bytes it was decoded from and is checked against memory whenever it is dispatched, so code
+// rewritten by the program, the debugger or anything else holding the memory pointer is decoded
+// again rather than run stale. Nothing here belongs to a machine, so one cache per thread serves
+// every machine it runs. Entries also keep the variant they were decoded for, machines of other
+// variants on the same thread just decode the addresses they run again.
+class FusionCache
+{
+public:
+	struct Entry
+	{
+		uint64_t Code;
+		word First;
+		Fusion Kind;
+		Variant Target;
+
+		// Instructions covered, 1 for anything run on its own
+		byte Length;
+	};
+
+	// Dispatches and the instructions they ran, in total and per kind of superinstruction
+	uint64_t Dispatches;
+	uint64_t Instructions;
+	uint64_t FusedInstructions[(int)Fusion::Count];
+
+	// Entries decoded again because the bytes under them changed
+	uint64_t Rewrites;
+
+private:
+	// Never looked past the end of memory, the last few addresses are always run one at a time
+	static const int CACHED = MEMORY_SIZE - 8;
+
+	// Code of an entry never decoded, no bytes masked to a single instruction can match it
+	static const uint64_t UNDECODED = ~0ull;
+
+	std::vector<Entry> entries;
+
+	// Masks off the bytes past an entry's last instruction, per length
+	uint64_t masks[5];
+
+public:
+	FusionCache();
+
+	static FusionCache& Local();
+
+	// Forgets every entry
+	void Clear();
+
+	void ResetCounts();
+
+	// Share of instructions run inside a superinstruction
+	double HitRate() const { return Instructions ? (double)(Instructions - FusedInstructions[(int)Fusion::None]) / Instructions : 0; }
+
+	const Entry& Lookup(const Chip8& cpu, word address)
+	{
+		if (address >= CACHED)
+		{
+			single = {0, (word)(cpu.Memory[address] << 8 | cpu.Memory[(address + 1) & MEMORY_MASK]), Fusion::None, cpu.Target, 1};
+			return single;
+		}
+
+		uint64_t bytes;
+		memcpy(&bytes, cpu.Memory + address, sizeof(bytes));
+
+		Entry& entry = entries[address];
+		bool rewritten = (bytes & masks[entry.Length]) != entry.Code;
+		if (rewritten || entry.Target != cpu.Target)
+		{
+			if (rewritten && entry.Code != UNDECODED)
+				Rewrites++;
+
+			entry = Decode(cpu, address);
+			entry.Code = bytes & masks[entry.Length];
+		}
+
+		return entry;
+	}
+
+	static Entry Decode(const Chip8& cpu, word address);
+
+private:
+	Entry single;
+};
+
+// Runs like Interpreter::Step over a budget, with superinstructions wherever the budget has
+// room for the whole of one. Observer hears about every instruction inside them as well.
+template <typename Quirks, typename Observer = NullObserver>
+struct FusedInterpreter
+{
+	using Run = Interpreter<Quirks, Observer>;
+
+	static word Word(const Chip8& cpu, word address, int index)
+	{
+		return cpu.Memory[address + index * 2] << 8 | cpu.Memory[address + index * 2 + 1];
+	}
+
+	static word Fetch(const Chip8& cpu, word address, int index)
+	{
+		word code = Word(cpu, address, index);
+		Observer::OnFetch(cpu, cpu.ProgramCounter, code);
+		return code;
+	}
+
+	static int Execute(Chip8& cpu, FusionCache& cache, int budget, bool& vblank)
+	{
+		int run = 0;
+		vblank = false;
+
+		while (run < budget && !vblank)
+		{
+			word address = cpu.ProgramCounter;
+			const FusionCache::Entry& entry = cache.Lookup(cpu, address);
+
+			int ran = 1;
+			if (entry.Kind == Fusion::None || entry.Length > budget - run)
+			{
+				Observer::OnFetch(cpu, address, entry.First);
+				Run::Execute(entry.First, cpu);
+				if constexpr (Quirks::DrawWaitsForVblank)
+					vblank = (entry.First & 0xF000) == 0xD000;
+
+				cache.FusedInstructions[(int)Fusion::None]++;
+			}
+			else
+			{
+				Observer::OnFetch(cpu, address, entry.First);
+				switch (entry.Kind)
+				{
+				case Fusion::IndexDraw:
+					Run::OpAnnn(entry.First, cpu);
+					Run::OpDxyn(Fetch(cpu, address, 1), cpu);
+					vblank = Quirks::DrawWaitsForVblank;
+					ran = 2;
+					break;
+
+				case Fusion::LoadRun:
+					Run::Op6xkk(entry.First, cpu);
+					for (int i = 1; i < entry.Length; i++)
+						Run::Op6xkk(Fetch(cpu, address, i), cpu);
+					ran = entry.Length;
+					break;
+
+				case Fusion::TimerPoll:
+					Run::OpFx07(entry.First, cpu);
+					Run::Op3xkk(Fetch(cpu, address, 1), cpu);
+					ran = 2;
+
+					// The jump only runs if the compare didn't skip over it
+					if (cpu.ProgramCounter == address + 4)
+					{
+						Run::Op1nnn(Fetch(cpu, address, 2), cpu);
+						ran = 3;
+					}
+					break;
+
+				case Fusion::CountLoop:
+					Run::Op7xkk(entry.First, cpu);
+					Run::Op3xkk(Fetch(cpu, address, 1), cpu);
+					ran = 2;
+					break;
+
+				case Fusion::IndexLoad:
+					Run::OpFx1E(entry.First, cpu);
+					Run::OpFx65(Fetch(cpu, address, 1), cpu);
+					ran = 2;
+					break;
+
+				default:
+					break;
+				}
+
+				cache.FusedInstructions[(int)entry.Kind] += ran;
+			}
+
+			cache.Dispatches++;
+			cache.Instructions += ran;
+			run += ran;
+		}
+
+		return run;
+	}
+
+	// Same as Interpreter::RunFrame
+	static int RunFrame(Chip8& cpu, FusionCache& cache, int cycles)
+	{
+		bool vblank;
+		int cycle = Execute(cpu, cache, cycles, vblank);
+
+		cpu.TickTimers();
+		return cycle;
+	}
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "Chip8.h"
+
+// Shared by the command line tools, so the bench, the golden runs and the headless runner all
+// load roms and press keys the same way
+
+// The whole file, or nothing if it can't be read
+inline std::vector<byte> ReadFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	return std::vector<byte>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+// Holds each of the 16 keys in turn for a few frames, with a gap in between, so roms that wait on
+// input keep moving. Bit k of the mask is key k.
+inline word ScriptedKeys(int frame)
+{
+	int key = (frame / 12) % 16;
+	bool held = (frame % 12) < 6;
+	return held ? (word)(1 << key) : 0;
+}
+
+inline void ScriptInput(Chip8& cpu, int frame)
+{
+	word mask = ScriptedKeys(frame);
+	for (int k = 0; k < 16; k++)
+		cpu.Keyboard[k] = (mask >> k) & 1;
+}
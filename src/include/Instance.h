@@ -0,0 +1,76 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include "Chip8.h"
+#include "Disassembly.h"
+#include "MemoryScanner.h"
+#include "Recorder.h"
+#include "Upscaler.h"
+
+struct MemoryView
+{
+	int HighlightFrames = 30;
+	int SelectedAddress = -1;
+	int ScrollTarget = -1;
+};
+
+struct ProgramView
+{
+	bool FollowPc = true;
+	int ScrollTarget = -1;
+	int LastProgramCounter = -1;
+};
+
+// One machine hosted by the frontend, with its rom, run state, display and debugger views. The
+// frontend steps several of these side by side, each in a panel of its own.
+struct Instance
+{
+	int Id;
+
+	std::string RomPath;
+	int RomLength = 0;
+
+	bool IsRomLoaded = false;
+	bool IsStateSaved = false;
+	bool IsPaused = false;
+	int CyclesPerFrame;
+	static const int MAX_CYCLES_PER_FRAME = 1000;
+
+	Chip8 Cpu;
+
+	// Spare machine the run-ahead frames are emulated on, shown instead of Cpu while ShowingRunAhead
+	std::unique_ptr<Chip8> AheadCpu = std::make_unique<Chip8>();
+	bool ShowingRunAhead = false;
+
+	sf::Color Palette[4];
+	byte KeyLayout[16];
+
+	std::unordered_set<int> Breakpoints;
+	MemoryScanner Scanner;
+	Disassembly Listing;
+	Recorder Recording;
+
+	Upscaler Scaler;
+	sf::Texture DisplayTexture;
+
+	// What was last drawn, so power saving can tell when the panel needs drawing again
+	uint64_t DrawnGraphics[DISPLAY_PLANES][DISPLAY_HEIGHT][DISPLAY_ROW_WORDS] = {};
+	bool DrawnHighResolution = false;
+	byte DrawnDelayTimer = 0;
+	byte DrawnSoundTimer = 0;
+
+	// Debugger views
+	int CpuStateTarget = 0;
+	int GraphicsColumn = 0;
+	MemoryView Memory;
+	ProgramView Program;
+	ScanPredicate CheatPredicate = ScanPredicate::Unchanged;
+	int CheatValue = 0;
+
+	const Chip8& Shown() const { return ShowingRunAhead ? *AheadCpu : Cpu; }
+};
@@ -0,0 +1,616 @@
+#pragma once
+#include <stdlib.h>
+
+#include "Chip8.h"
+#include "Observer.h"
+#include "Quirks.h"
+
+// The opcode semantics, specialised per quirk profile. Every profile gets its own copy of the
+// decode switch and handlers with the quirks resolved at compile time, see Opcode.h for the
+// human readable side of each instruction. Observer gets told about fetches, memory and the
+// framebuffer as they are touched, see Observer.h.
+template <typename Quirks, typename Observer = NullObserver>
+struct Interpreter
+{
+	static word Fetch(const Chip8& cpu)
+	{
+		return cpu.Memory[cpu.ProgramCounter] << 8 | cpu.Memory[(cpu.ProgramCounter + 1) & MEMORY_MASK];
+	}
+
+	// Runs one instruction, returns true if it has to wait for the next vblank
+	static bool Step(Chip8& cpu)
+	{
+		word instruction = Fetch(cpu);
+		Observer::OnFetch(cpu, cpu.ProgramCounter, instruction);
+		Execute(instruction, cpu);
+
+		if constexpr (Quirks::DrawWaitsForVblank)
+			return (instruction & 0xF000) == 0xD000;
+		else
+			return false;
+	}
+
+	// Runs up to cycles instructions followed by one tick of the timers, returns the cycles run
+	static int RunFrame(Chip8& cpu, int cycles)
+	{
+		int cycle = 0;
+		while (cycle < cycles)
+		{
+			cycle++;
+			if (Step(cpu))
+				break;
+		}
+
+		cpu.TickTimers();
+		return cycle;
+	}
+
+	static void Execute(word code, Chip8& cpu)
+	{
+		switch ((code >> 12))
+		{
+		case 0x0:
+			switch (code & 0xFF)
+			{
+			case 0xE0: return Op00E0(code, cpu);
+			case 0xEE: return Op00EE(code, cpu);
+			}
+			break;
+
+		case 0x1: return Op1nnn(code, cpu);
+		case 0x2: return Op2nnn(code, cpu);
+		case 0x3: return Op3xkk(code, cpu);
+		case 0x4: return Op4xkk(code, cpu);
+
+		case 0x5:
+			if ((code & 0xF) == 0x0)
+				return Op5xy0(code, cpu);
+			break;
+
+		case 0x6: return Op6xkk(code, cpu);
+		case 0x7: return Op7xkk(code, cpu);
+
+		case 0x8:
+			switch (code & 0xF)
+			{
+			case 0x0: return Op8xy0(code, cpu);
+			case 0x1: return Op8xy1(code, cpu);
+			case 0x2: return Op8xy2(code, cpu);
+			case 0x3: return Op8xy3(code, cpu);
+			case 0x4: return Op8xy4(code, cpu);
+			case 0x5: return Op8xy5(code, cpu);
+			case 0x6: return Op8xy6(code, cpu);
+			case 0x7: return Op8xy7(code, cpu);
+			case 0xE: return Op8xyE(code, cpu);
+			}
+			break;
+
+		case 0x9: return Op9xy0(code, cpu);
+		case 0xA: return OpAnnn(code, cpu);
+		case 0xB: return OpBnnn(code, cpu);
+		case 0xC: return OpCxkk(code, cpu);
+
+		case 0xD:
+			if constexpr (Quirks::Target != Variant::Chip8)
+			{
+				if ((code & 0xF) == 0x0)
+					return OpDxy0(code, cpu);
+			}
+			return OpDxyn(code, cpu);
+
+		case 0xE:
+			switch (code & 0xFF)
+			{
+			case 0xA1: return OpExA1(code, cpu);
+			case 0x9E: return OpEx9E(code, cpu);
+			}
+			break;
+
+		case 0xF:
+			switch (code & 0xFF)
+			{
+			case 0x07: return OpFx07(code, cpu);
+			case 0x0A: return OpFx0A(code, cpu);
+			case 0x15: return OpFx15(code, cpu);
+			case 0x18: return OpFx18(code, cpu);
+			case 0x1E: return OpFx1E(code, cpu);
+			case 0x29: return OpFx29(code, cpu);
+			case 0x33: return OpFx33(code, cpu);
+			case 0x55: return OpFx55(code, cpu);
+			case 0x65: return OpFx65(code, cpu);
+			}
+			break;
+		}
+
+		if constexpr (Quirks::Target != Variant::Chip8)
+			return ExecuteExtended(code, cpu);
+		else
+			return Nop(code, cpu);
+	}
+
+	static void ExecuteExtended(word code, Chip8& cpu)
+	{
+		constexpr bool xo = Quirks::Target == Variant::XoChip;
+
+		switch ((code >> 12))
+		{
+		case 0x0:
+			if ((code & 0xFFF0) == 0x00C0)
+				return Op00Cn(code, cpu);
+
+			if (xo && (code & 0xFFF0) == 0x00D0)
+				return Op00Dn(code, cpu);
+
+			switch (code & 0xFFF)
+			{
+			case 0x0FB: return Op00FB(code, cpu);
+			case 0x0FC: return Op00FC(code, cpu);
+			case 0x0FD: return Op00FD(code, cpu);
+			case 0x0FE: return Op00FE(code, cpu);
+			case 0x0FF: return Op00FF(code, cpu);
+			}
+			break;
+
+		case 0x5:
+			if (!xo)
+				break;
+
+			switch (code & 0xF)
+			{
+			case 0x2: return Op5xy2(code, cpu);
+			case 0x3: return Op5xy3(code, cpu);
+			}
+			break;
+
+		case 0xF:
+			if (xo && code == 0xF000)
+				return OpF000(code, cpu);
+
+			switch (code & 0xFF)
+			{
+			case 0x30: return OpFx30(code, cpu);
+			case 0x75: return OpFx75(code, cpu);
+			case 0x85: return OpFx85(code, cpu);
+			}
+
+			if (!xo)
+				break;
+
+			switch (code & 0xFF)
+			{
+			case 0x01: return OpFn01(code, cpu);
+			case 0x02: return (code == 0xF002) ? OpF002(code, cpu) : Nop(code, cpu);
+			case 0x3A: return OpFx3A(code, cpu);
+			}
+			break;
+		}
+
+		return Nop(code, cpu);
+	}
+
+	// XO-CHIP's F000 nnnn is four bytes long, so skips have to hop over the whole of it
+	static word SkipLength(const Chip8& cpu)
+	{
+		if constexpr (Quirks::Target != Variant::XoChip)
+		{
+			return 4;
+		}
+		else
+		{
+			word next = cpu.Memory[(cpu.ProgramCounter + 2) & MEMORY_MASK] << 8 | cpu.Memory[(cpu.ProgramCounter + 3) & MEMORY_MASK];
+			return next == 0xF000 ? 6 : 4;
+		}
+	}
+
+	static void Nop(word code, Chip8& cpu)
+	{
+		cpu.RaiseFault(FAULT_UNKNOWN_OPCODE);
+		cpu.ProgramCounter += 2;
+	}
+
+	// Only XO-CHIP has more than 4 KB, anywhere else length bytes at I have to fit below that
+	static void CheckIndex(Chip8& cpu, int length)
+	{
+		if constexpr (Quirks::Target != Variant::XoChip)
+		{
+			if (cpu.IndexRegister + length > 0x1000)
+				cpu.RaiseFault(FAULT_INDEX_RANGE);
+		}
+	}
+
+	static int SelectedPlanes(const Chip8& cpu)
+	{
+		return (cpu.PlaneMask & 1) + ((cpu.PlaneMask >> 1) & 1);
+	}
+
+	static void DrewWholeDisplay(const Chip8& cpu)
+	{
+		Observer::OnDraw(cpu, 0, 0, cpu.DisplayWidth(), cpu.DisplayHeight());
+	}
+
+	static void DrewSprite(const Chip8& cpu, byte x, byte y, int width, int height)
+	{
+		Observer::OnRead(cpu, cpu.IndexRegister, width / 8 * height * SelectedPlanes(cpu));
+		Observer::OnDraw(cpu, x & (cpu.DisplayWidth() - 1), y & (cpu.DisplayHeight() - 1), width, height);
+	}
+
+	static void Op00E0(word code, Chip8& cpu)
+	{
+		cpu.ClearDisplay();
+		DrewWholeDisplay(cpu);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op00EE(word code, Chip8& cpu)
+	{
+		if (cpu.StackPointer == 0)
+			cpu.RaiseFault(FAULT_STACK_UNDERFLOW);
+
+		cpu.StackPointer--;
+		cpu.ProgramCounter = cpu.Stack[cpu.StackPointer & 0xF] + 2;
+	}
+
+	static void Op1nnn(word code, Chip8& cpu)
+	{
+		cpu.ProgramCounter = (code & 0x0FFF);
+	}
+
+	static void Op2nnn(word code, Chip8& cpu)
+	{
+		if (cpu.StackPointer >= 16)
+			cpu.RaiseFault(FAULT_STACK_OVERFLOW);
+
+		cpu.Stack[cpu.StackPointer & 0xF] = cpu.ProgramCounter;
+		cpu.StackPointer++;
+		cpu.ProgramCounter = (code & 0x0FFF);
+	}
+
+	static void Op3xkk(word code, Chip8& cpu)
+	{
+		cpu.ProgramCounter += (cpu.Registers[(code & 0x0F00) >> 8] == (code & 0x00FF)) ? SkipLength(cpu) : 2;
+	}
+
+	static void Op4xkk(word code, Chip8& cpu)
+	{
+		cpu.ProgramCounter += (cpu.Registers[(code & 0x0F00) >> 8] != (code & 0x00FF)) ? SkipLength(cpu) : 2;
+	}
+
+	static void Op5xy0(word code, Chip8& cpu)
+	{
+		cpu.ProgramCounter += (cpu.Registers[(code & 0x0F00) >> 8] == cpu.Registers[(code & 0x00F0) >> 4]) ? SkipLength(cpu) : 2;
+	}
+
+	static void Op6xkk(word code, Chip8& cpu)
+	{
+		cpu.Registers[(code & 0x0F00) >> 8] = (code & 0x00FF);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op7xkk(word code, Chip8& cpu)
+	{
+		cpu.Registers[(code & 0x0F00) >> 8] += (code & 0x00FF);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xy0(word code, Chip8& cpu)
+	{
+		cpu.Registers[(code & 0x0F00) >> 8] = cpu.Registers[(code & 0x00F0) >> 4];
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xy1(word code, Chip8& cpu)
+	{
+		cpu.Registers[(code & 0x0F00) >> 8] |= cpu.Registers[(code & 0x00F0) >> 4];
+		if constexpr (Quirks::LogicResetsVF)
+			cpu.Registers[0xF] = 0;
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xy2(word code, Chip8& cpu)
+	{
+		cpu.Registers[(code & 0x0F00) >> 8] &= cpu.Registers[(code & 0x00F0) >> 4];
+		if constexpr (Quirks::LogicResetsVF)
+			cpu.Registers[0xF] = 0;
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xy3(word code, Chip8& cpu)
+	{
+		cpu.Registers[(code & 0x0F00) >> 8] ^= cpu.Registers[(code & 0x00F0) >> 4];
+		if constexpr (Quirks::LogicResetsVF)
+			cpu.Registers[0xF] = 0;
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xy4(word code, Chip8& cpu)
+	{
+		cpu.Registers[0xF] = ((int)(cpu.Registers[(code & 0x0F00) >> 8]) + cpu.Registers[(code & 0x00F0) >> 4] > 0xFF) ? 1 : 0;
+		cpu.Registers[(code & 0x0F00) >> 8] += cpu.Registers[(code & 0x00F0) >> 4];
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xy5(word code, Chip8& cpu)
+	{
+		cpu.Registers[0xF] = ((int)(cpu.Registers[(code & 0x0F00) >> 8]) - cpu.Registers[(code & 0x00F0) >> 4] < 0) ? 0 : 1;
+		cpu.Registers[(code & 0x0F00) >> 8] -= cpu.Registers[(code & 0x00F0) >> 4];
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xy6(word code, Chip8& cpu)
+	{
+		byte source = cpu.Registers[Quirks::ShiftUsesVy ? (code & 0x00F0) >> 4 : (code & 0x0F00) >> 8];
+		cpu.Registers[(code & 0x0F00) >> 8] = source >> 1;
+		cpu.Registers[0xF] = source & 0x1;
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xy7(word code, Chip8& cpu)
+	{
+		cpu.Registers[0xF] = (cpu.Registers[(code & 0x00F0) >> 4]) > (cpu.Registers[(code & 0x0F00) >> 8]) ? 1 : 0;
+		cpu.Registers[(code & 0x0F00) >> 8] = (cpu.Registers[(code & 0x00F0) >> 4]) - (cpu.Registers[(code & 0x0F00) >> 8]);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op8xyE(word code, Chip8& cpu)
+	{
+		byte source = cpu.Registers[Quirks::ShiftUsesVy ? (code & 0x00F0) >> 4 : (code & 0x0F00) >> 8];
+		cpu.Registers[(code & 0x0F00) >> 8] = source << 1;
+		cpu.Registers[0xF] = (source & 0x80) >> 0x7;
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op9xy0(word code, Chip8& cpu)
+	{
+		cpu.ProgramCounter += (cpu.Registers[(code & 0x0F00) >> 8] != cpu.Registers[(code & 0x00F0) >> 4]) ? SkipLength(cpu) : 2;
+	}
+
+	static void OpAnnn(word code, Chip8& cpu)
+	{
+		cpu.IndexRegister = (code & 0x0FFF);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpBnnn(word code, Chip8& cpu)
+	{
+		cpu.ProgramCounter = (code & 0x0FFF) + cpu.Registers[Quirks::JumpUsesVx ? (code & 0x0F00) >> 8 : 0];
+	}
+
+	static void OpCxkk(word code, Chip8& cpu)
+	{
+		cpu.Registers[(code & 0x0F00) >> 8] = cpu.NextRandom() & (code & 0x00FF);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpDxyn(word code, Chip8& cpu)
+	{
+		byte x = cpu.Registers[(code & 0x0F00) >> 8];
+		byte y = cpu.Registers[(code & 0x00F0) >> 4];
+
+		CheckIndex(cpu, (code & 0x000F) * SelectedPlanes(cpu));
+		cpu.Registers[0xF] = cpu.DrawSprite<Quirks::SpritesWrap>(x, y, 8, code & 0x000F) ? 1 : 0;
+		DrewSprite(cpu, x, y, 8, code & 0x000F);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpEx9E(word code, Chip8& cpu)
+	{
+		cpu.ProgramCounter += (cpu.Keyboard[cpu.Registers[(code & 0x0F00) >> 8] & 0xF]) ? SkipLength(cpu) : 2;
+	}
+
+	static void OpExA1(word code, Chip8& cpu)
+	{
+		cpu.ProgramCounter += !(cpu.Keyboard[cpu.Registers[(code & 0x0F00) >> 8] & 0xF]) ? SkipLength(cpu) : 2;
+	}
+
+	static void OpFx07(word code, Chip8& cpu)
+	{
+		cpu.Registers[(code & 0x0F00) >> 8] = cpu.DelayTimer;
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx0A(word code, Chip8& cpu)
+	{
+		for (int k = 0; k < 16; k++)
+		{
+			if (cpu.Keyboard[k])
+			{
+				cpu.Registers[(code & 0x0F00) >> 8] = k;
+				cpu.ProgramCounter += 2;
+				break;
+			}
+		}
+	}
+
+	static void OpFx15(word code, Chip8& cpu)
+	{
+		cpu.DelayTimer = cpu.Registers[(code & 0x0F00) >> 8];
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx18(word code, Chip8& cpu)
+	{
+		cpu.SoundTimer = cpu.Registers[(code & 0x0F00) >> 8];
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx1E(word code, Chip8& cpu)
+	{
+		cpu.IndexRegister += cpu.Registers[(code & 0x0F00) >> 8];
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx29(word code, Chip8& cpu)
+	{
+		cpu.IndexRegister = 80 + (5 * cpu.Registers[(code & 0x0F00) >> 8]);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx33(word code, Chip8& cpu)
+	{
+		CheckIndex(cpu, 3);
+		cpu.MarkDirty(cpu.IndexRegister, 3);
+		cpu.Memory[(cpu.IndexRegister + 2) & MEMORY_MASK] = cpu.Registers[(code & 0x0F00) >> 8] % 10;
+		cpu.Memory[(cpu.IndexRegister + 1) & MEMORY_MASK] = (cpu.Registers[(code & 0x0F00) >> 8] / 10) % 10;
+		cpu.Memory[(cpu.IndexRegister + 0) & MEMORY_MASK] = cpu.Registers[(code & 0x0F00) >> 8] / 100;
+		Observer::OnWrite(cpu, cpu.IndexRegister, 3);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx55(word code, Chip8& cpu)
+	{
+		CheckIndex(cpu, ((code & 0x0F00) >> 8) + 1);
+		cpu.MarkDirty(cpu.IndexRegister, ((code & 0x0F00) >> 8) + 1);
+		for (uint8_t i = 0; i <= ((code & 0x0F00) >> 8); i++)
+			cpu.Memory[(cpu.IndexRegister + i) & MEMORY_MASK] = cpu.Registers[i];
+		Observer::OnWrite(cpu, cpu.IndexRegister, ((code & 0x0F00) >> 8) + 1);
+		if constexpr (Quirks::LoadStoreIncrementsI)
+			cpu.IndexRegister += ((code & 0x0F00) >> 8) + 1;
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx65(word code, Chip8& cpu)
+	{
+		CheckIndex(cpu, ((code & 0x0F00) >> 8) + 1);
+		for (uint8_t i = 0; i <= ((code & 0x0F00) >> 8); i++)
+			cpu.Registers[i] = cpu.Memory[(cpu.IndexRegister + i) & MEMORY_MASK];
+		Observer::OnRead(cpu, cpu.IndexRegister, ((code & 0x0F00) >> 8) + 1);
+		if constexpr (Quirks::LoadStoreIncrementsI)
+			cpu.IndexRegister += ((code & 0x0F00) >> 8) + 1;
+		cpu.ProgramCounter += 2;
+	}
+
+	// SUPER-CHIP
+
+	static void Op00Cn(word code, Chip8& cpu)
+	{
+		cpu.ScrollDown(code & 0x000F);
+		DrewWholeDisplay(cpu);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op00FB(word code, Chip8& cpu)
+	{
+		cpu.ScrollRight(4);
+		DrewWholeDisplay(cpu);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op00FC(word code, Chip8& cpu)
+	{
+		cpu.ScrollLeft(4);
+		DrewWholeDisplay(cpu);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op00FD(word code, Chip8& cpu)
+	{
+		// Spin in place, the frontend notices the program counter is stuck
+	}
+
+	static void Op00FE(word code, Chip8& cpu)
+	{
+		cpu.SetResolution(false);
+		DrewWholeDisplay(cpu);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op00FF(word code, Chip8& cpu)
+	{
+		cpu.SetResolution(true);
+		DrewWholeDisplay(cpu);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpDxy0(word code, Chip8& cpu)
+	{
+		byte x = cpu.Registers[(code & 0x0F00) >> 8];
+		byte y = cpu.Registers[(code & 0x00F0) >> 4];
+
+		CheckIndex(cpu, 32 * SelectedPlanes(cpu));
+		cpu.Registers[0xF] = cpu.DrawSprite<Quirks::SpritesWrap>(x, y, 16, 16) ? 1 : 0;
+		DrewSprite(cpu, x, y, 16, 16);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx30(word code, Chip8& cpu)
+	{
+		cpu.IndexRegister = 160 + (10 * (cpu.Registers[(code & 0x0F00) >> 8] & 0xF));
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx75(word code, Chip8& cpu)
+	{
+		for (uint8_t i = 0; i <= ((code & 0x0F00) >> 8); i++)
+			cpu.Flags[i] = cpu.Registers[i];
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx85(word code, Chip8& cpu)
+	{
+		for (uint8_t i = 0; i <= ((code & 0x0F00) >> 8); i++)
+			cpu.Registers[i] = cpu.Flags[i];
+		cpu.ProgramCounter += 2;
+	}
+
+	// XO-CHIP
+
+	static void Op00Dn(word code, Chip8& cpu)
+	{
+		cpu.ScrollUp(code & 0x000F);
+		DrewWholeDisplay(cpu);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op5xy2(word code, Chip8& cpu)
+	{
+		int x = (code & 0x0F00) >> 8, y = (code & 0x00F0) >> 4;
+		int step = x <= y ? 1 : -1;
+		cpu.MarkDirty(cpu.IndexRegister, abs(y - x) + 1);
+		for (int i = 0; i <= abs(y - x); i++)
+			cpu.Memory[(cpu.IndexRegister + i) & MEMORY_MASK] = cpu.Registers[x + i * step];
+		Observer::OnWrite(cpu, cpu.IndexRegister, abs(y - x) + 1);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void Op5xy3(word code, Chip8& cpu)
+	{
+		int x = (code & 0x0F00) >> 8, y = (code & 0x00F0) >> 4;
+		int step = x <= y ? 1 : -1;
+		for (int i = 0; i <= abs(y - x); i++)
+			cpu.Registers[x + i * step] = cpu.Memory[(cpu.IndexRegister + i) & MEMORY_MASK];
+		Observer::OnRead(cpu, cpu.IndexRegister, abs(y - x) + 1);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpF000(word code, Chip8& cpu)
+	{
+		cpu.IndexRegister = cpu.Memory[(cpu.ProgramCounter + 2) & MEMORY_MASK] << 8 | cpu.Memory[(cpu.ProgramCounter + 3) & MEMORY_MASK];
+		cpu.ProgramCounter += 4;
+	}
+
+	static void OpFn01(word code, Chip8& cpu)
+	{
+		cpu.PlaneMask = ((code & 0x0F00) >> 8) & 0x3;
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpF002(word code, Chip8& cpu)
+	{
+		for (int i = 0; i < 16; i++)
+			cpu.AudioPattern[i] = cpu.Memory[(cpu.IndexRegister + i) & MEMORY_MASK];
+		Observer::OnRead(cpu, cpu.IndexRegister, 16);
+		cpu.ProgramCounter += 2;
+	}
+
+	static void OpFx3A(word code, Chip8& cpu)
+	{
+		cpu.Pitch = cpu.Registers[(code & 0x0F00) >> 8];
+		cpu.ProgramCounter += 2;
+	}
+};
+
+// The common profiles are compiled once in Interpreter.cpp
+extern template struct Interpreter<Quirks::CosmacVip>;
+extern template struct Interpreter<Quirks::Modern>;
+extern template struct Interpreter<Quirks::SuperChip>;
+extern template struct Interpreter<Quirks::XoChip>;
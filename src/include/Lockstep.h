@@ -0,0 +1,66 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include "Chip8.h"
+
+// A way of executing instructions. Run goes until it has run budget instructions or one of them
+// has to wait for the next vblank, and returns how many it ran. It may stop short but has to run
+// at least one, and with a budget of one it must run exactly one.
+struct Engine
+{
+	const char* Name;
+	int (*Run)(Chip8& cpu, int budget, bool& vblank);
+};
+
+extern const Engine ENGINES[];
+extern const int ENGINE_COUNT;
+
+// Returns nullptr for a name that isn't in ENGINES
+const Engine* FindEngine(const std::string& name);
+
+// Runs a reference and a candidate engine side by side on two copies of the same machine and
+// compares them after every block the candidate runs. Blocks only compare the CPU state and the
+// memory either side wrote, the display and the whole of memory are compared at the end of every
+// frame. On a mismatch the frame is replayed one instruction at a time to find the instruction
+// that diverged.
+class Lockstep
+{
+public:
+	// Most instructions the candidate is given at once, 1 compares after every instruction
+	int BlockSize;
+
+private:
+	const Engine* referenceEngine;
+	const Engine* candidateEngine;
+
+	std::unique_ptr<Chip8> reference;
+	std::unique_ptr<Chip8> candidate;
+
+	// The reference as the frame started, for the replay after a mismatch
+	std::unique_ptr<Chip8> referenceFrame;
+
+	uint64_t instructions;
+	uint64_t frameInstructions;
+	std::string divergence;
+
+public:
+	Lockstep(const Engine& reference, const Engine& candidate);
+
+	void LoadRom(byte* code, int len, Profile profile, uint32_t seed);
+	void SetKeys(word mask);
+
+	// Runs one frame of up to cycles instructions on both, returns false once they have diverged
+	bool RunFrame(int cycles);
+
+	const Chip8& Reference() const { return *reference; }
+	uint64_t Instructions() const { return instructions; }
+
+	// What differed and the instruction that did it, empty until RunFrame fails
+	const std::string& Divergence() const { return divergence; }
+
+private:
+	bool Matches(bool wholeMachine);
+	void Explain(int blockStart, int blockLength, bool frameEnd);
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "Chip8.h"
+
+enum class ScanPredicate : byte
+{
+	Unchanged,
+	Changed,
+	Increased,
+	Decreased,
+	EqualTo,
+	Count
+};
+
+const char* ScanPredicateName(ScanPredicate predicate);
+
+// Cheat search over memory and the V registers. A scan snapshots every byte, and each narrowing
+// pass compares the bytes as they are now against that snapshot (or a value) and drops the
+// addresses that don't match from a candidate bitmap, 16 at a time. Scan addresses past the
+// end of memory are the registers, SCAN_REGISTERS + x is Vx.
+class MemoryScanner
+{
+public:
+	static const int SCAN_REGISTERS = MEMORY_SIZE;
+	static const int SCAN_SIZE = MEMORY_SIZE + 16;
+
+	struct Freeze
+	{
+		int Address;
+		byte Value;
+	};
+
+	struct Watch
+	{
+		int Address;
+		byte Seen;
+	};
+
+private:
+	std::vector<byte> previous;
+	std::vector<uint64_t> candidates;
+	int count;
+	bool scanning;
+
+	std::vector<Freeze> freezes;
+	std::vector<Watch> watches;
+
+public:
+	MemoryScanner();
+
+	// Snapshots everything and makes every address the program can reach a candidate again
+	void Start(const Chip8& cpu);
+
+	// Keeps the candidates matching the predicate and takes a new snapshot, returns what is left
+	int Narrow(const Chip8& cpu, ScanPredicate predicate, byte value = 0);
+
+	bool IsScanning() const { return scanning; }
+	int Count() const { return count; }
+
+	// Up to limit candidate addresses in order
+	int Candidates(int* out, int limit) const;
+
+	byte Previous(int address) const { return previous[address]; }
+	static byte Read(const Chip8& cpu, int address);
+	static void Write(Chip8& cpu, int address, byte value);
+
+	// Frozen addresses get their value written back every frame
+	void AddFreeze(int address, byte value);
+	void RemoveFreeze(int address);
+	const std::vector<Freeze>& Freezes() const { return freezes; }
+	void ApplyFreezes(Chip8& cpu) const;
+
+	// Watched addresses stop the emulator when their value changes
+	void AddWatch(const Chip8& cpu, int address);
+	void RemoveWatch(int address);
+	const std::vector<Watch>& Watches() const { return watches; }
+
+	// True if a watched value changed since the last call, the watches then take the new values
+	bool CheckWatches(const Chip8& cpu);
+
+private:
+	void Snapshot(const Chip8& cpu);
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+#include "Chip8.h"
+
+// Throughput counters for fleets of headless runs, exported in the Prometheus text format. Each
+// thread counts into a shard of its own with plain relaxed stores, so the hot loop never takes a
+// lock or shares a cache line, and a scrape adds the shards up. Shards outlive their threads so
+// the totals never go backwards.
+//
+//   Metrics::Shard& shard = Metrics::Local();    once, outside the loop
+//   shard.Add(Metrics::FRAMES, 1);
+namespace Metrics
+{
+	enum Counter
+	{
+		INSTRUCTIONS,
+		FRAMES,
+		IDLE_FRAMES,	// frames skipped because the machine was blocked on a key or a halt
+		IDLE_CYCLES,	// the instructions those frames would have spun through
+		SNAPSHOTS,
+		RESTORES,
+		FUSION_DISPATCHES,	// trips through the superinstruction cache, see Fusion.h
+		FUSION_HITS,		// instructions run inside a superinstruction
+		FUSION_REWRITES,	// cache entries decoded again because the code under them changed
+		COUNTER_COUNT
+	};
+
+	// Histogram buckets, one per leading nibble of the instruction
+	const int OPCODE_GROUPS = 16;
+
+	class alignas(64) Shard
+	{
+	private:
+		std::atomic<uint64_t> counters[COUNTER_COUNT];
+		std::atomic<uint64_t> opcodes[OPCODE_GROUPS];
+
+	public:
+		Shard();
+
+		// Only the owning thread writes, so a load and a store is enough and keeps it a plain add
+		void Add(Counter counter, uint64_t count)
+		{
+			counters[counter].store(counters[counter].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+		}
+
+		void AddOpcodes(const uint64_t* groups)
+		{
+			for (int group = 0; group < OPCODE_GROUPS; group++)
+				opcodes[group].store(opcodes[group].load(std::memory_order_relaxed) + groups[group], std::memory_order_relaxed);
+		}
+
+		uint64_t Get(Counter counter) const { return counters[counter].load(std::memory_order_relaxed); }
+		uint64_t Opcodes(int group) const { return opcodes[group].load(std::memory_order_relaxed); }
+	};
+
+	// This thread's shard, registered on first use
+	Shard& Local();
+
+	// One frame like Chip8::RunFrame, superinstructions and all, counted into shard along with the
+	// opcode histogram. A blocked machine would only spin in place, so the frame is skipped and
+	// the timers ticked instead.
+	int RunFrame(Chip8& cpu, int cycles, Shard& shard);
+
+	// Every shard added up, in the Prometheus text exposition format
+	std::string Scrape();
+
+	// Answers any HTTP request with a scrape, from a background thread. The endpoint is a port on
+	// 127.0.0.1, or a Unix socket path if it holds a '/'.
+	bool Serve(const std::string& endpoint);
+
+	// Appends a scrape to path every intervalMs from a background thread, moving the file to
+	// path.1 once it grows past maxBytes
+	bool StartFile(const std::string& path, int intervalMs, uint64_t maxBytes);
+
+	// Stops both exports, the file gets one last scrape
+	void Stop();
+}
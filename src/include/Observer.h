@@ -0,0 +1,34 @@
+#pragma once
+#include "Chip8.h"
+
+// Hooks the interpreter calls as it runs, chosen at compile time through its Observer parameter.
+// Every hook here is empty and inline, so the default Interpreter<Quirks> compiles to the same
+// code it would with no hooks at all. A tool derives from NullObserver, hides the hooks it
+// wants, and instantiates Interpreter<Quirks, ItsObserver>; Observers<A, B> runs several.
+//
+// Hooks are static. Observers that keep state hold it somewhere they can reach from there, a
+// thread_local pointer is enough for one machine per thread.
+struct NullObserver
+{
+	// Before the instruction at address runs
+	static void OnFetch(const Chip8& cpu, word address, word code) { }
+
+	// Data read from memory by an instruction, sprites included, after the read
+	static void OnRead(const Chip8& cpu, word address, int length) { }
+
+	// Memory written by an instruction, after the write
+	static void OnWrite(const Chip8& cpu, word address, int length) { }
+
+	// A rectangle of the framebuffer written by a draw, in pixels of the current resolution.
+	// Clears, scrolls and resolution changes report the whole display.
+	static void OnDraw(const Chip8& cpu, int x, int y, int width, int height) { }
+};
+
+template <typename... List>
+struct Observers
+{
+	static void OnFetch(const Chip8& cpu, word address, word code) { (List::OnFetch(cpu, address, code), ...); }
+	static void OnRead(const Chip8& cpu, word address, int length) { (List::OnRead(cpu, address, length), ...); }
+	static void OnWrite(const Chip8& cpu, word address, int length) { (List::OnWrite(cpu, address, length), ...); }
+	static void OnDraw(const Chip8& cpu, int x, int y, int width, int height) { (List::OnDraw(cpu, x, y, width, height), ...); }
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+
+// Scoped timing zones for the frontend loop. With CHIP8_PROFILING undefined the macros expand to
+// nothing, so a release build carries none of it. Everything here is main thread only.
+//
+//   PROFILE_ZONE("RenderDisplay");   times the rest of the enclosing scope
+//   PROFILE_FRAME();                 closes the current frame and starts the next
+
+#ifdef CHIP8_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) \
+	static const int PROFILE_CONCAT(profileZoneId, __LINE__) = Profiler::RegisterZone(name); \
+	ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(PROFILE_CONCAT(profileZoneId, __LINE__))
+#define PROFILE_FRAME() Profiler::EndFrame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
+
+namespace Profiler
+{
+	const int MAX_ZONES = 32;
+	const int HISTORY_FRAMES = 240;
+
+	// Index of the whole frame in the queries below, zones are numbered from 0
+	const int FRAME = -1;
+
+	struct Percentiles
+	{
+		float P50;
+		float P99;
+		float Max;
+	};
+
+	int64_t Now();
+
+	int RegisterZone(const char* name);
+	void Record(int zone, int64_t start, int64_t end);
+	void EndFrame();
+
+	int ZoneCount();
+	const char* ZoneName(int zone);
+
+	// Milliseconds spent in zone over the last HISTORY_FRAMES frames, oldest first
+	int History(int zone, float* out);
+	Percentiles Summarize(int zone);
+
+	// Collects every zone as a Chrome trace_event, viewable in Perfetto or chrome://tracing
+	void StartCapture();
+	bool IsCapturing();
+	bool StopCapture(const std::string& path);
+}
+
+class ProfileZone
+{
+private:
+	int zone;
+	int64_t start;
+
+public:
+	explicit ProfileZone(int zone)
+		: zone(zone), start(Profiler::Now())
+	{ }
+
+	~ProfileZone()
+	{
+		Profiler::Record(zone, start, Profiler::Now());
+	}
+};
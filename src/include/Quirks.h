@@ -0,0 +1,96 @@
+#pragma once
+#include "Chip8.h"
+
+// Each profile answers the questions CHIP-8 interpreters historically disagree on. They are only
+// ever used as template arguments, so every answer is folded away at compile time.
+namespace Quirks
+{
+	// The original COSMAC VIP interpreter
+	struct CosmacVip
+	{
+		static constexpr const char* Name = "CHIP-8 (COSMAC VIP)";
+		static constexpr Variant Target = Variant::Chip8;
+		static constexpr int CyclesPerFrame = 10;
+
+		static constexpr bool ShiftUsesVy = true;
+		static constexpr bool LoadStoreIncrementsI = true;
+		static constexpr bool JumpUsesVx = false;
+		static constexpr bool LogicResetsVF = true;
+		static constexpr bool SpritesWrap = false;
+		static constexpr bool DrawWaitsForVblank = true;
+	};
+
+	// What this emulator has always done, close to CHIP-48 minus the Bnnn change
+	struct Modern
+	{
+		static constexpr const char* Name = "CHIP-8 (Modern)";
+		static constexpr Variant Target = Variant::Chip8;
+		static constexpr int CyclesPerFrame = 10;
+
+		static constexpr bool ShiftUsesVy = false;
+		static constexpr bool LoadStoreIncrementsI = false;
+		static constexpr bool JumpUsesVx = false;
+		static constexpr bool LogicResetsVF = false;
+		static constexpr bool SpritesWrap = false;
+		static constexpr bool DrawWaitsForVblank = false;
+	};
+
+	// SUPER-CHIP 1.1 on the HP48
+	struct SuperChip
+	{
+		static constexpr const char* Name = "SUPER-CHIP 1.1";
+		static constexpr Variant Target = Variant::SuperChip;
+		static constexpr int CyclesPerFrame = 30;
+
+		static constexpr bool ShiftUsesVy = false;
+		static constexpr bool LoadStoreIncrementsI = false;
+		static constexpr bool JumpUsesVx = true;
+		static constexpr bool LogicResetsVF = false;
+		static constexpr bool SpritesWrap = false;
+		static constexpr bool DrawWaitsForVblank = false;
+	};
+
+	// XO-CHIP as implemented by Octo
+	struct XoChip
+	{
+		static constexpr const char* Name = "XO-CHIP";
+		static constexpr Variant Target = Variant::XoChip;
+		static constexpr int CyclesPerFrame = 200;
+
+		static constexpr bool ShiftUsesVy = true;
+		static constexpr bool LoadStoreIncrementsI = true;
+		static constexpr bool JumpUsesVx = false;
+		static constexpr bool LogicResetsVF = false;
+		static constexpr bool SpritesWrap = true;
+		static constexpr bool DrawWaitsForVblank = false;
+	};
+}
+
+// Calls visitor with an instance of the profile type, which is how a run-time choice of profile
+// picks one of the pre-instantiated interpreters
+template <typename Visitor>
+decltype(auto) VisitProfile(Profile profile, Visitor&& visitor)
+{
+	switch (profile)
+	{
+	case Profile::CosmacVip: return visitor(Quirks::CosmacVip());
+	case Profile::SuperChip: return visitor(Quirks::SuperChip());
+	case Profile::XoChip: return visitor(Quirks::XoChip());
+	default: return visitor(Quirks::Modern());
+	}
+}
+
+inline const char* ProfileName(Profile profile)
+{
+	return VisitProfile(profile, [](auto quirks) { return decltype(quirks)::Name; });
+}
+
+inline Variant ProfileVariant(Profile profile)
+{
+	return VisitProfile(profile, [](auto quirks) { return decltype(quirks)::Target; });
+}
+
+inline int ProfileCyclesPerFrame(Profile profile)
+{
+	return VisitProfile(profile, [](auto quirks) { return decltype(quirks)::CyclesPerFrame; });
+}
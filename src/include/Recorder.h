@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Chip8.h"
+
+enum class RecordFormat : byte
+{
+	Gif,
+	Y4m
+};
+
+// Records the framebuffer to an animated GIF or a raw Y4M video. Capture only copies a changed
+// frame into a queue allocated up front, a worker thread does all the encoding and file I/O,
+// and a full queue drops the frame rather than wait. Frames are always laid out on the
+// 128x64 hi-res canvas, lo-res frames are doubled up to fill it.
+class Recorder
+{
+public:
+	static const int QUEUE_FRAMES = 256;
+	static const int FRAMES_PER_SECOND = 60;
+
+private:
+	struct Snapshot
+	{
+		uint64_t Graphics[DISPLAY_PLANES][DISPLAY_HEIGHT][DISPLAY_ROW_WORDS];
+		bool HighResolution;
+		uint32_t Frame;
+	};
+
+	// Single producer, single consumer ring, head is only written by Capture and tail by the worker
+	std::vector<Snapshot> queue;
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+
+	std::thread worker;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	std::atomic<bool> stopping;
+	std::atomic<bool> failed;
+
+	// Capture side
+	Snapshot last;
+	bool hasLast;
+	uint32_t frame;
+	uint32_t dropped;
+
+	// Worker side
+	FILE* file;
+	RecordFormat format;
+	int scale;
+	uint32_t palette[4];
+	int canvasWidth, canvasHeight;
+
+	// Palette indices of the frame last written, the one waiting to learn how long it lasts
+	// and the one just taken off the queue
+	std::vector<byte> written;
+	std::vector<byte> pending;
+	std::vector<byte> current;
+	uint32_t pendingFrame;
+	bool hasPending;
+	bool hasWritten;
+
+	// GIF LZW dictionary, four children per code over the four colour alphabet
+	static const int LZW_CODES = 4096;
+	std::vector<int16_t> lzwChildren;
+
+public:
+	Recorder();
+	~Recorder();
+
+	// palette is four colours packed as R, G, B, A bytes, scale is the size of a hi-res pixel
+	bool Start(const std::string& path, RecordFormat format, const uint32_t palette[4], int scale = 4);
+	void Stop();
+
+	// Call once per emulated frame, frames the same as the last one only move the clock on
+	void Capture(const Chip8& cpu);
+
+	bool IsRecording() const { return file != nullptr; }
+	bool Failed() const { return failed; }
+	uint32_t DroppedFrames() const { return dropped; }
+
+	// Frames queued and not yet encoded
+	uint32_t Backlog() const { return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire); }
+
+	static RecordFormat FormatForPath(const std::string& path);
+
+private:
+	void Work();
+	void Encode(const Snapshot& snapshot);
+	void Finish(uint32_t endFrame);
+
+	void Rasterize(const Snapshot& snapshot, std::vector<byte>& out);
+
+	void WriteGifHeader();
+	void WriteGifFrame(const std::vector<byte>& pixels, uint32_t frames);
+	void WriteY4mFrame(const std::vector<byte>& pixels, uint32_t frames);
+};
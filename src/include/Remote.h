@@ -0,0 +1,99 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Chip8.h"
+
+// Binary remote control over a Unix domain socket, for driving the emulator from test harnesses.
+// Everything is little endian. A request is an 8 byte header, u32 payload length, u16 tag,
+// u8 command and a zero byte, then the payload. Every request gets one response in the order
+// they were sent: u32 payload length, the same tag and command, a status byte, then the payload.
+// Requests can be pipelined freely, everything that has arrived is served on each Poll. A client
+// that stops reading its responses stops being served once a few megabytes of them are waiting.
+enum class RemoteCommand : byte
+{
+	Hello,			// -> u32 protocol version, u8 profile, u32 frame
+	LoadRom,		// rom bytes
+	Step,			// u32 cycles -> u32 cycles run, u16 pc
+	RunFrames,		// u32 frames -> u32 frames run, u16 pc
+	SetKeys,		// u16 mask, bit k holds key k down
+	ReadMemory,		// u32 address, u32 length -> bytes
+	WriteMemory,	// u32 address, bytes
+	SetBreakpoint,	// u16 address
+	ClearBreakpoint,	// u16 address
+	ClearBreakpoints,
+	Snapshot,		// u8 slot
+	Restore,		// u8 slot
+	Framebuffer,	// -> u8 hi-res, then both planes as 64 rows of two u64 each, MSB leftmost
+	Registers,		// -> V0-VF, u16 I, u16 pc, u8 sp, u8 delay, u8 sound, 16 x u16 stack
+	SetPaused,		// u8 paused, only the frontend has anything to pause
+	Close,			// the connection is closed once this is answered
+	Count
+};
+
+enum class RemoteStatus : byte
+{
+	Ok,
+	Breakpoint,		// stopped early on a breakpoint, the counts say how far it got
+	BadRequest,
+	UnknownCommand
+};
+
+class RemoteServer
+{
+public:
+	static const uint32_t PROTOCOL_VERSION = 1;
+	static const int SNAPSHOT_SLOTS = 16;
+	static const uint32_t MAX_PAYLOAD = 1 << 20;
+
+	// What Poll did, for the frontend to catch up with
+	static const int CHANGED = 1 << 0;
+	static const int LOADED_ROM = 1 << 1;
+	static const int PAUSED = 1 << 2;
+	static const int RESUMED = 1 << 3;
+	static const int DISCONNECTED = 1 << 4;
+
+	// Called after every frame a RunFrames request finishes, for recording
+	std::function<void(const Chip8&)> OnFrame;
+
+private:
+	std::string path;
+	int listener;
+	int client;
+
+	std::vector<byte> input;
+	std::vector<byte> output;
+	size_t outputSent;
+	bool closing;
+
+	std::unique_ptr<Chip8> slots[SNAPSHOT_SLOTS];
+
+public:
+	RemoteServer();
+	~RemoteServer();
+
+	bool Listen(const std::string& path);
+	void Close();
+
+	bool IsListening() const { return listener >= 0; }
+	bool IsConnected() const { return client >= 0; }
+
+	// Blocks until there is something to serve or timeoutMs passes, -1 waits for ever
+	bool Wait(int timeoutMs);
+
+	// Serves every request waiting without blocking, returns a mask of the flags above
+	int Poll(Chip8& cpu, std::unordered_set<int>& breakpoints, int cyclesPerFrame);
+
+private:
+	void Accept();
+	bool Receive();
+	void Send();
+	void Disconnect();
+
+	int Serve(RemoteCommand command, const byte* payload, uint32_t length, Chip8& cpu,
+		std::unordered_set<int>& breakpoints, int cyclesPerFrame, RemoteStatus& status, std::vector<byte>& reply);
+};
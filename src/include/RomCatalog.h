@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Chip8.h"
+
+// How a rom wants to be run, applied by the frontend when a known rom is loaded
+struct RomSettings
+{
+	Profile QuirkProfile;
+	int CyclesPerFrame;
+	uint32_t Palette[4];
+
+	// KeyLayout[k] is the slot on the host 4x4 grid (1234/QWER/ASDF/ZXCV) that drives key k
+	byte KeyLayout[16];
+};
+
+struct KnownRom
+{
+	const char* Hash;
+	const char* Title;
+	RomSettings Settings;
+};
+
+struct RomEntry
+{
+	std::string Path;
+	uintmax_t Size;
+	int64_t ModifiedTime;
+	std::string Hash;
+	const KnownRom* Known;
+};
+
+// One directory scan, run on a background thread and merged by RomCatalog::Poll once Done is set
+struct CatalogScan
+{
+	std::string Directory;
+	std::vector<RomEntry> Found;
+	int Hashed = 0;
+	std::atomic<bool> Done{false};
+};
+
+// Indexes rom directories by content hash. Every scanned directory keeps an index file keyed by
+// size and modification time, so only new or changed files are hashed again on a rescan.
+class RomCatalog
+{
+public:
+	static const char* IndexName;
+	static const RomSettings DefaultSettings;
+
+private:
+	std::unordered_map<std::string, RomEntry> entries;
+	std::vector<std::shared_ptr<CatalogScan>> scans;
+
+public:
+	// Returns the number of files that had to be hashed
+	int Scan(const std::string& directory);
+
+	// Scan on a background thread, a directory already being scanned isn't started again
+	void ScanAsync(const std::string& directory);
+
+	// Takes in the background scans that have finished, true if there were any
+	bool Poll();
+
+	// Only hashes path itself if it isn't indexed yet, the rest of its directory is indexed in
+	// the background. The entry lasts until the next Scan or Poll.
+	const RomEntry* Find(const std::string& path);
+
+	static const KnownRom* Identify(const std::string& hash);
+
+private:
+	static void RunScan(CatalogScan& scan);
+	void Merge(CatalogScan& scan);
+
+	static void ReadIndex(const std::string& directory, std::unordered_map<std::string, RomEntry>& cached);
+	static void WriteIndex(const std::string& directory, const std::vector<RomEntry>& roms);
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+
+#include "Chip8.h"
+
+// Plain SHA-1, the digest the CHIP-8 community databases identify roms by
+std::string Sha1(const byte* data, size_t len);
@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+
+#include "Chip8.h"
+
+struct chip8_shared_segment;
+
+// Publishes a machine's display, keys and registers into a POSIX shared memory segment once a
+// frame, for overlays, bots and visualisers in other processes. Readers use the library in
+// shared/, see Chip8Shared.h for the layout. Publishing is a seqlock write of a couple of
+// kilobytes with no system calls, and readers never hold the writer up.
+//
+// Not available on Windows, Open just fails there.
+class SharedExport
+{
+private:
+	std::string name;
+	chip8_shared_segment* segment;
+	uint64_t sequence;
+
+public:
+	SharedExport();
+	~SharedExport();
+
+	SharedExport(const SharedExport&) = delete;
+	SharedExport& operator=(const SharedExport&) = delete;
+
+	// Creates or takes over the segment called name, which starts with a '/' like "/chip8"
+	bool Open(const std::string& name);
+
+	// Marks the segment closed for readers and removes its name
+	void Close();
+
+	bool IsOpen() const { return segment != nullptr; }
+
+	void Publish(const Chip8& cpu);
+};
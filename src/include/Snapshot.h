@@ -0,0 +1,36 @@
+#pragma once
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Chip8.h"
+
+// Leads every saved Chip8, in .c8ss files and C API snapshots alike. The size catches a snapshot
+// from a build with a different Chip8 layout, so it is refused rather than copied over a machine,
+// and so is one whose cycles per frame would leave the machine stuck or overflow an int.
+struct SnapshotHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t Size;
+	uint32_t CyclesPerFrame;
+
+	static SnapshotHeader For(int cyclesPerFrame)
+	{
+		SnapshotHeader header;
+		memcpy(header.Magic, MAGIC, sizeof(header.Magic));
+		header.Version = VERSION;
+		header.Size = sizeof(Chip8);
+		header.CyclesPerFrame = (uint32_t)cyclesPerFrame;
+		return header;
+	}
+
+	bool IsValid() const
+	{
+		return memcmp(Magic, MAGIC, sizeof(Magic)) == 0 && Version == VERSION && Size == sizeof(Chip8)
+			&& CyclesPerFrame >= 1 && CyclesPerFrame <= (uint32_t)INT_MAX;
+	}
+
+	static constexpr char MAGIC[4] = {'C', '8', 'S', 'S'};
+	static constexpr uint32_t VERSION = 1;
+};
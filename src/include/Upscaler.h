@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "Chip8.h"
+
+enum class ScaleFilter : byte
+{
+	Nearest,
+	Scale2x,
+	Scale3x,
+	Xbr,
+	Count
+};
+
+const char* ScaleFilterName(ScaleFilter filter);
+
+// Turns the bit-packed framebuffer into an RGBA image for the display. The chosen filter runs
+// at the source resolution, then the result is blown up by the largest whole factor that fits
+// and scanlines are masked in. Colours are four bytes in R, G, B, A memory order, the layout
+// sf::Texture::update takes.
+class Upscaler
+{
+public:
+	ScaleFilter Filter;
+
+	// How much of each scanline gap is blacked out, 0 turns scanlines off
+	byte ScanlineStrength;
+
+	// Phosphor persistence, the share of a pixel's glow out of 256 left after each frame. 0 turns
+	// it off. The filter is skipped while it is on, the filters only know the four flat colours.
+	byte PersistenceDecay;
+
+private:
+	// Source palette indices with two replicated pixels of border on every side, so the filters
+	// can read their whole neighbourhood without bounds checks. Rows are padded to keep the
+	// vector loads of the interior aligned.
+	static const int BORDER_COLUMNS = 16;
+	static const int BORDER_ROWS = 2;
+
+	std::vector<byte> indices;
+	int indexStride;
+	int sourceWidth, sourceHeight;
+
+	std::vector<byte> scaledIndices;
+	std::vector<uint32_t> filtered;
+	int filteredWidth, filteredHeight;
+
+	std::vector<uint32_t> pixels;
+	int width, height;
+
+	// Glow of every source pixel on each plane, laid out plane by plane, and which rows are still
+	// fading and need work even when the framebuffer row hasn't changed
+	static const int GLOW_LEVELS = 32;
+
+	std::vector<byte> glow;
+	bool fading[DISPLAY_HEIGHT];
+	bool rowsChanged[DISPLAY_HEIGHT];
+	uint32_t glowPalette[GLOW_LEVELS * GLOW_LEVELS];
+
+	// What the current image was made from, so an unchanged frame costs a compare
+	uint64_t drawnGraphics[DISPLAY_PLANES][DISPLAY_HEIGHT][DISPLAY_ROW_WORDS];
+	bool drawnHighResolution;
+	uint32_t drawnPalette[4];
+	ScaleFilter drawnFilter;
+	byte drawnScanlineStrength;
+	byte drawnPersistenceDecay;
+	int drawnMaxWidth, drawnMaxHeight;
+	bool valid;
+
+public:
+	Upscaler();
+
+	// Returns false if nothing changed since the last call and the image is still current
+	bool Render(const Chip8& cpu, const uint32_t palette[4], int maxWidth, int maxHeight);
+
+	const uint32_t* Pixels() const { return pixels.data(); }
+	int Width() const { return width; }
+	int Height() const { return height; }
+
+	// True while persistence still has pixels fading, so the display needs redrawing every frame
+	bool Fading() const;
+
+	static uint32_t PackColor(byte r, byte g, byte b, byte a = 255);
+
+private:
+	void Unpack(const Chip8& cpu);
+	byte Index(int x, int y) const { return indices[(y + BORDER_ROWS) * indexStride + x + BORDER_COLUMNS]; }
+
+	void Scale2x();
+	void Scale3x();
+	void Xbr(const uint32_t palette[4]);
+	void Lookup(const byte* source, const uint32_t palette[4]);
+
+	bool Persist(const Chip8& cpu, const uint32_t palette[4], bool current);
+	bool DecayRow(const Chip8& cpu, int y);
+
+	void Expand(int scale, const bool* rows = nullptr);
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that run batches of independent jobs. Run hands out job indices to the
+// workers and the calling thread alike and returns once every job in the batch has finished, so
+// whatever the jobs wrote is safe to read afterwards. Batches are meant to be small and frequent,
+// like stepping a handful of machines once a frame.
+class WorkerPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable finished;
+
+	const std::function<void(int)>* job;
+	int count;
+	std::atomic<int> next;
+	int busy;
+	uint64_t batch;
+	bool stopping;
+
+public:
+	// Threads besides the caller's, by default one less than the machine has
+	explicit WorkerPool(int threads = -1);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	void Run(int jobs, const std::function<void(int)>& run);
+
+	int Threads() const { return (int)workers.size() + 1; }
+
+private:
+	void Work();
+	void Drain();
+};